@@ -2,13 +2,73 @@
 #define RUST_STREAMS_H
 
 #include<tuple>
+#include<array>
+#include<vector>
+#include<utility>
+#include<functional>
+#include<deque>
+#include<algorithm>
+#include<cassert>
+#include<cmath>
+#include<cstdint>
+#include<cstring>
+#include<cstdio>
+#include<cstdlib>
+#include<cerrno>
+#include<string>
+#include<sstream>
+#include<thread>
+#include<atomic>
+#include<chrono>
+#include<mutex>
+#include<condition_variable>
+#include<iterator>
+#include<limits>
+#include<memory>
+#include<exception>
+
+#if __cplusplus >= 201703L && defined __has_include
+#if __has_include(<charconv>)
+#include <charconv>
+#endif
+#endif
+
+#if __cplusplus >= 202002L && defined __has_include
+#if __has_include(<ranges>)
+#include <ranges>
+#endif
+#if __has_include(<coroutine>) && defined __cpp_impl_coroutine
+#include <coroutine>
+#include <exception>
+#define STREAMS_COROUTINES
+#endif
+#endif
+
+#if defined __unix__ || defined __APPLE__
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/uio.h>
+#endif
+
+#if defined __linux__ && defined __has_include
+#if __has_include(<linux/io_uring.h>)
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#define STREAMS_IO_URING
+#endif
+#endif
 
 #if defined _MSC_VER
 #include "Optional/optional.hpp"
+#include <string_view>
 #define CONSTEXPR
+#define EMPTY_BASES __declspec(empty_bases)
 # else
 #include <experimental/optional>
+#include <experimental/string_view>
 #define CONSTEXPR constexpr
+#define EMPTY_BASES
 #endif
 
 namespace streams {
@@ -18,6 +78,12 @@ namespace streams {
 
     using std::experimental::nullopt;
 
+#if defined _MSC_VER
+    using StringView = std::string_view;
+#else
+    using StringView = std::experimental::string_view;
+#endif
+
     template<typename... Args>
     using Tuple = std::tuple<Args...>;
 
@@ -33,9 +99,28 @@ namespace streams {
 
         template<typename Extractor, typename Functor>
         using ApplyOnValueType = decltype(std::declval<Functor>()(std::declval<decltype(*(std::declval<Extractor>().get()))>()));
+
+        template<typename...>
+        using VoidType = void;
+
+        template<typename Extractor, typename = void>
+        struct IsRandomAccess : std::false_type {};
+
+        template<typename Extractor>
+        struct IsRandomAccess<Extractor, VoidType<decltype(std::declval<Extractor&>().remaining_impl()),
+                                                  decltype(std::declval<Extractor&>().jump_impl(size_t{}))>> : std::true_type {};
+
+        template<bool... Values>
+        using AllOf = std::is_same<std::integer_sequence<bool, true, Values...>, std::integer_sequence<bool, Values..., true>>;
+
+        template<typename... Extractors>
+        using AllRandomAccess = AllOf<IsRandomAccess<Extractors>::value...>;
     }
 
 
+    // Random-access extractors (traits::IsRandomAccess) also implement
+    //   size_t remaining_impl() - how many elements are left, SIZE_MAX for endless sources
+    //   void jump_impl(size_t n) - drops the next n <= remaining() elements without visiting them
     template <typename DerivedStreamExtractor>
     struct StreamExtractor {
 
@@ -46,36 +131,136 @@ namespace streams {
         bool advance() noexcept(noexcept(std::declval<DerivedStreamExtractor>().advance_impl())) {
             return static_cast<DerivedStreamExtractor*>(this)->advance_impl();
         }
+
+        size_t remaining() {
+            return static_cast<DerivedStreamExtractor*>(this)->remaining_impl();
+        }
+
+        void jump(size_t n) {
+            static_cast<DerivedStreamExtractor*>(this)->jump_impl(n);
+        }
     };
 
+    namespace detail {
+        // drops n elements, in O(1) for random-access extractors; false if the source ran out
+        template<typename Extractor>
+        std::enable_if_t<traits::IsRandomAccess<Extractor>::value, bool> skipElements(Extractor& extractor, size_t n) {
+            const size_t remaining = extractor.remaining();
+            extractor.jump(std::min(n, remaining));
+            return n <= remaining;
+        }
+
+        template<typename Extractor>
+        std::enable_if_t<!traits::IsRandomAccess<Extractor>::value, bool> skipElements(Extractor& extractor, size_t n) {
+            for (; n != 0; --n) {
+                if (!extractor.advance()) {
+                    return false;
+                }
+            }
+            return true;
+        }
+
+        // what get() returns for an element computed on the fly: the element itself, dereferenced
+        // like a pointer, so that the extractor needs no member to keep it
+        template<typename T>
+        struct ValuePointer {
+            T value;
+
+            T& operator * () { return value; }
+            const T& operator * () const { return value; }
+            T* operator -> () { return &value; }
+            const T* operator -> () const { return &value; }
+        };
+
+        template<typename T>
+        ValuePointer<T> pointerTo(T&& value) {
+            return { std::forward<T>(value) };
+        }
+
+        template<typename T>
+        T* pointerTo(T& value) {
+            return &value;
+        }
+
+        template<typename T>
+        struct IsValuePointer : std::false_type {};
+
+        template<typename T>
+        struct IsValuePointer<ValuePointer<T>> : std::true_type {};
+
+        // holds a functor; an empty one (a lambda without captures, std::less, ...) becomes a base
+        // class so that it takes no space in the extractor (the empty-base optimization)
+        template<typename F, bool = std::is_empty<F>::value && !std::is_final<F>::value>
+        struct FunctorStorage {
+            FunctorStorage(F&& f) : f(std::forward<F>(f)) {}
+
+            F f;
+
+            F& functor() { return f; }
+        };
+
+        template<typename F>
+        struct FunctorStorage<F, true> : private F {
+            FunctorStorage(F&& f) : F(std::forward<F>(f)) {}
+
+            F& functor() { return *this; }
+        };
+
+        // the element before next: recomputed with std::prev where the iterator can step back,
+        // remembered otherwise
+        template<typename Iterator, bool = std::is_base_of<std::bidirectional_iterator_tag, typename std::iterator_traits<Iterator>::iterator_category>::value>
+        struct SequenceCursor {
+            Iterator next;
+
+            Iterator current() const { return std::prev(next); }
+            void step() { ++next; }
+        };
+
+        template<typename Iterator>
+        struct SequenceCursor<Iterator, false> {
+            Iterator next;
+            Iterator last = next;
+
+            Iterator current() const { return last; }
+            void step() { last = next++; }
+        };
+    }
+
     template <typename IteratorType>
     struct SequenceStreamExtractor : StreamExtractor<SequenceStreamExtractor<IteratorType>> {
-        SequenceStreamExtractor(IteratorType&& b, IteratorType&& e) 
-            : current(std::forward<IteratorType>(b)), next(std::forward<IteratorType>(b))
-            , begin(std::forward<IteratorType>(b)), end(std::forward<IteratorType>(e)) {}
+        SequenceStreamExtractor(IteratorType&& b, IteratorType&& e)
+            : cursor{ std::forward<IteratorType>(b) }, end(std::forward<IteratorType>(e)) {}
 
-        IteratorType current;
-        IteratorType next;
-        const IteratorType begin;
-        const IteratorType end;
+        detail::SequenceCursor<IteratorType> cursor;
+        IteratorType end;
 
         auto get_impl() noexcept {
-            return current;
+            return cursor.current();
         }
 
         bool advance_impl() {
-            if (next != end) {
-                current = next++;
+            if (cursor.next != end) {
+                cursor.step();
                 return true;
             } else {
                 return false;
             }
         }
+
+        template<typename It = IteratorType, typename = std::enable_if_t<std::is_base_of<std::random_access_iterator_tag, typename std::iterator_traits<It>::iterator_category>::value>>
+        size_t remaining_impl() const {
+            return static_cast<size_t>(end - cursor.next);
+        }
+
+        template<typename It = IteratorType, typename = std::enable_if_t<std::is_base_of<std::random_access_iterator_tag, typename std::iterator_traits<It>::iterator_category>::value>>
+        void jump_impl(size_t n) {
+            cursor.next += static_cast<typename std::iterator_traits<It>::difference_type>(n);
+        }
     };
 
     template<typename ExtractorType>
     struct SkipFirstStreamExtractor : StreamExtractor<SkipFirstStreamExtractor<ExtractorType>> {
-        SkipFirstStreamExtractor(ExtractorType extractor, size_t count) : source(extractor), skipCount(count) {}
+        SkipFirstStreamExtractor(ExtractorType extractor, size_t count) : source(std::move(extractor)), skipCount(count) {}
 
         ExtractorType source;
         size_t skipCount;
@@ -85,23 +270,35 @@ namespace streams {
         }
 
         bool advance_impl() {
-            while (skipCount != 0) {
-                --skipCount;
-                if (!source.advance()) {
+            if (skipCount != 0) {
+                const bool skipped = detail::skipElements(source, skipCount);
+                skipCount = 0;
+                if (!skipped) {
                     return false;
                 }
             }
             return source.advance();
         }
 
+        template<typename E = ExtractorType, typename = std::enable_if_t<traits::IsRandomAccess<E>::value>>
+        size_t remaining_impl() {
+            const size_t left = source.remaining();
+            return left - std::min(left, skipCount);
+        }
+
+        template<typename E = ExtractorType, typename = std::enable_if_t<traits::IsRandomAccess<E>::value>>
+        void jump_impl(size_t n) {
+            source.jump(std::min(n + skipCount, source.remaining())); // the skip may reach past the end
+            skipCount = 0;
+        }
+
     };
 
     template<typename ExtractorType, typename Predicate>
-    struct SkipWhileStreamExtractor : StreamExtractor<SkipWhileStreamExtractor<ExtractorType, Predicate>> {
-        SkipWhileStreamExtractor(ExtractorType extractor, Predicate&& predicate) : source(extractor), predicate(std::forward<Predicate>(predicate)) {}
+    struct EMPTY_BASES SkipWhileStreamExtractor : StreamExtractor<SkipWhileStreamExtractor<ExtractorType, Predicate>>, detail::FunctorStorage<Predicate> {
+        SkipWhileStreamExtractor(ExtractorType extractor, Predicate&& predicate) : detail::FunctorStorage<Predicate>(std::forward<Predicate>(predicate)), source(std::move(extractor)) {}
 
         ExtractorType source;
-        Predicate predicate;
         bool skipping = true;
 
         auto get_impl() {
@@ -111,7 +308,7 @@ namespace streams {
         bool advance_impl() {
             if (skipping) {
                 while (skipping && source.advance()) {
-                    skipping = predicate(*source.get());
+                    skipping = this->functor()(*source.get());
                 }
                 return !skipping; // depleted stream : skipping == true
             } else {
@@ -123,7 +320,7 @@ namespace streams {
 
     template<typename ExtractorType>
     struct TakeStreamExtractor : StreamExtractor<TakeStreamExtractor<ExtractorType>> {
-        TakeStreamExtractor(ExtractorType extractor, size_t count) : source(extractor), limit(count) {}
+        TakeStreamExtractor(ExtractorType extractor, size_t count) : source(std::move(extractor)), limit(count) {}
 
         ExtractorType source;
         size_t limit;
@@ -140,14 +337,99 @@ namespace streams {
             return false;
         }
 
+        template<typename E = ExtractorType, typename = std::enable_if_t<traits::IsRandomAccess<E>::value>>
+        size_t remaining_impl() {
+            return std::min(limit, source.remaining());
+        }
+
+        template<typename E = ExtractorType, typename = std::enable_if_t<traits::IsRandomAccess<E>::value>>
+        void jump_impl(size_t n) {
+            limit -= n;
+            source.jump(n);
+        }
+
+    };
+
+    // take<N>(): the bound is a constant, so loops over the stream have a known trip count
+    template<typename ExtractorType, size_t N>
+    struct TakeFixedStreamExtractor : StreamExtractor<TakeFixedStreamExtractor<ExtractorType, N>> {
+        TakeFixedStreamExtractor(ExtractorType extractor) : source(std::move(extractor)) {}
+
+        ExtractorType source;
+        size_t taken = 0;
+
+        auto get_impl() {
+            return source.get();
+        }
+
+        bool advance_impl() {
+            if (taken != N) {
+                ++taken;
+                return source.advance();
+            }
+            return false;
+        }
+
+        template<typename E = ExtractorType, typename = std::enable_if_t<traits::IsRandomAccess<E>::value>>
+        size_t remaining_impl() {
+            return std::min(N - taken, source.remaining());
+        }
+
+        template<typename E = ExtractorType, typename = std::enable_if_t<traits::IsRandomAccess<E>::value>>
+        void jump_impl(size_t n) {
+            taken += n;
+            source.jump(n);
+        }
+
+    };
+
+    // up to Capacity elements stored inline, without heap allocations; T must be default constructible
+    template<typename T, size_t Capacity>
+    struct FixedVector {
+        std::array<T, Capacity> items {};
+        size_t length = 0;
+
+        // false, leaving the vector unchanged, when it is full
+        bool push_back(const T& value) {
+            if (length == Capacity) {
+                return false;
+            }
+            items[length++] = value;
+            return true;
+        }
+
+        size_t size() const { return length; }
+        static constexpr size_t capacity() { return Capacity; }
+        bool empty() const { return length == 0; }
+        bool full() const { return length == Capacity; }
+
+        T& operator [] (size_t i) { return items[i]; }
+        const T& operator [] (size_t i) const { return items[i]; }
+
+        T* data() { return items.data(); }
+        const T* data() const { return items.data(); }
+
+        T* begin() { return items.data(); }
+        T* end() { return items.data() + length; }
+        const T* begin() const { return items.data(); }
+        const T* end() const { return items.data() + length; }
     };
 
+    template<typename T, size_t Capacity>
+    bool operator == (const FixedVector<T, Capacity>& lhs, const FixedVector<T, Capacity>& rhs) {
+        return lhs.size() == rhs.size() && std::equal(lhs.begin(), lhs.end(), rhs.begin());
+    }
+
+    template<typename T, size_t Capacity>
+    bool operator != (const FixedVector<T, Capacity>& lhs, const FixedVector<T, Capacity>& rhs) {
+        return !(lhs == rhs);
+    }
+
     template<typename ExtractorType, typename Predicate>
-    struct TakeWhileStreamExtractor : StreamExtractor<TakeWhileStreamExtractor<ExtractorType, Predicate>> {
-        TakeWhileStreamExtractor(ExtractorType extractor, Predicate&& predicate) : source(extractor), predicate(std::forward<Predicate>(predicate)) {}
+    struct EMPTY_BASES TakeWhileStreamExtractor : StreamExtractor<TakeWhileStreamExtractor<ExtractorType, Predicate>>, detail::FunctorStorage<Predicate> {
+        TakeWhileStreamExtractor(ExtractorType extractor, Predicate&& predicate) : detail::FunctorStorage<Predicate>(std::forward<Predicate>(predicate)), source(std::move(extractor)) {}
 
         ExtractorType source;
-        Predicate predicate;
         bool taking = true;
 
         auto get_impl() {
@@ -155,7 +437,7 @@ namespace streams {
         }
 
         bool advance_impl() {
-            taking &= taking && source.advance() && predicate(*source.get());
+            taking &= taking && source.advance() && this->functor()(*source.get());
             return taking;
         }
 
@@ -163,11 +445,10 @@ namespace streams {
 
 
     template<typename ExtractorType, typename Predicate>
-    struct FilterStreamExtractor : StreamExtractor<FilterStreamExtractor<ExtractorType, Predicate>> {
-        FilterStreamExtractor(ExtractorType extractor, Predicate&& p) : source(extractor), predicate(std::forward<Predicate>(p)) {}
+    struct EMPTY_BASES FilterStreamExtractor : StreamExtractor<FilterStreamExtractor<ExtractorType, Predicate>>, detail::FunctorStorage<Predicate> {
+        FilterStreamExtractor(ExtractorType extractor, Predicate&& p) : detail::FunctorStorage<Predicate>(std::forward<Predicate>(p)), source(std::move(extractor)) {}
 
         ExtractorType source;
-        Predicate predicate;
 
         auto get_impl() {
             return source.get();
@@ -178,7 +459,7 @@ namespace streams {
                 return false;
             }
             auto elementPtr = source.get();
-            while (!predicate(*elementPtr)) {
+            while (!this->functor()(*elementPtr)) {
                 if (source.advance()) {
                     elementPtr = source.get();
                 } else {
@@ -192,11 +473,10 @@ namespace streams {
 
 
     template<typename ExtractorType, typename Transform>
-    struct FilterMapStreamExtractor : StreamExtractor<FilterMapStreamExtractor<ExtractorType, Transform>> {
-        FilterMapStreamExtractor(ExtractorType extractor, Transform&& t) : source(extractor), transform(std::forward<Transform>(t)) {}
+    struct EMPTY_BASES FilterMapStreamExtractor : StreamExtractor<FilterMapStreamExtractor<ExtractorType, Transform>>, detail::FunctorStorage<Transform> {
+        FilterMapStreamExtractor(ExtractorType extractor, Transform&& t) : detail::FunctorStorage<Transform>(std::forward<Transform>(t)), source(std::move(extractor)) {}
 
         ExtractorType source;
-        Transform transform;
 
         traits::ValueType<ExtractorType> storage {};
 
@@ -211,7 +491,7 @@ namespace streams {
                 if (!source.advance()) {
                     return false;
                 }
-                auto e = transform(*source.get());
+                auto e = this->functor()(*source.get());
                 if (e) {
                     storage = *e;
                     return true;
@@ -223,32 +503,37 @@ namespace streams {
 
 
     template<typename ExtractorType, typename Transform>
-    struct MapStreamExtractor : StreamExtractor<MapStreamExtractor<ExtractorType, Transform>> {
-        MapStreamExtractor(ExtractorType sourceExtractor, Transform&& transform) : source(sourceExtractor), transformer(std::forward<Transform>(transform)) {}
+    struct EMPTY_BASES MapStreamExtractor : StreamExtractor<MapStreamExtractor<ExtractorType, Transform>>, detail::FunctorStorage<Transform> {
+        MapStreamExtractor(ExtractorType sourceExtractor, Transform&& transform) : detail::FunctorStorage<Transform>(std::forward<Transform>(transform)), source(std::move(sourceExtractor)) {}
 
         ExtractorType source;
-        Transform transformer;
-
-        traits::ApplyOnValueType<ExtractorType, Transform> value;
 
         auto get_impl() {
-            value = transformer(*source.get());
-            return &value;
+            return detail::pointerTo(this->functor()(*source.get()));
         }
 
         bool advance_impl() {
             return source.advance();
         }
 
+        template<typename E = ExtractorType, typename = std::enable_if_t<traits::IsRandomAccess<E>::value>>
+        size_t remaining_impl() {
+            return source.remaining();
+        }
+
+        template<typename E = ExtractorType, typename = std::enable_if_t<traits::IsRandomAccess<E>::value>>
+        void jump_impl(size_t n) {
+            source.jump(n);
+        }
+
     };
 
 
     template<typename ExtractorType, typename Transform>
-    struct FlatMapStreamExtractor : StreamExtractor<FlatMapStreamExtractor<ExtractorType, Transform>> {
-        FlatMapStreamExtractor(ExtractorType sourceExtractor, Transform&& transform) : source(sourceExtractor), transformer(std::forward<Transform>(transform)) {}
+    struct EMPTY_BASES FlatMapStreamExtractor : StreamExtractor<FlatMapStreamExtractor<ExtractorType, Transform>>, detail::FunctorStorage<Transform> {
+        FlatMapStreamExtractor(ExtractorType sourceExtractor, Transform&& transform) : detail::FunctorStorage<Transform>(std::forward<Transform>(transform)), source(std::move(sourceExtractor)) {}
 
         ExtractorType source;
-        Transform transformer;
 
         traits::ApplyOnValueType<ExtractorType, Transform> innerCollection{};
         SequenceStreamExtractor<decltype(std::begin(innerCollection))> sequence{ std::begin(innerCollection), std::end(innerCollection) };
@@ -261,7 +546,7 @@ namespace streams {
         bool advance_impl() {
             if (!sequence.advance()) {
                 if (source.advance()) {
-                    innerCollection = transformer(*source.get()); // what if SequenceStreamExtractor::IteratorType needs to free some resource?
+                    innerCollection = this->functor()(*source.get()); // what if SequenceStreamExtractor::IteratorType needs to free some resource?
                     new(&sequence) SequenceStreamExtractor<decltype(std::begin(innerCollection))> { std::begin(innerCollection), std::end(innerCollection) };
                     return advance_impl();
                 }
@@ -278,11 +563,10 @@ namespace streams {
 
 
     template<typename ExtractorType, typename Inspector>
-    struct InspectStreamExtractor : StreamExtractor<InspectStreamExtractor<ExtractorType, Inspector>> {
-        InspectStreamExtractor(ExtractorType extractor, Inspector&& inspector) : source(extractor), inspector(std::forward<Inspector>(inspector)) {}
+    struct EMPTY_BASES InspectStreamExtractor : StreamExtractor<InspectStreamExtractor<ExtractorType, Inspector>>, detail::FunctorStorage<Inspector> {
+        InspectStreamExtractor(ExtractorType extractor, Inspector&& inspector) : detail::FunctorStorage<Inspector>(std::forward<Inspector>(inspector)), source(std::move(extractor)) {}
 
         ExtractorType source;
-        Inspector inspector;
 
         auto get_impl() {
             return source.get();
@@ -290,7 +574,7 @@ namespace streams {
 
         bool advance_impl() {
             if (source.advance()) {
-                inspector(*source.get());
+                this->functor()(*source.get());
                 return true;
             }
             return false;
@@ -300,15 +584,14 @@ namespace streams {
 
 
     template<typename ExtractorType, typename Inspector>
-    struct SpyStreamExtractor : StreamExtractor<SpyStreamExtractor<ExtractorType, Inspector>> {
-        SpyStreamExtractor(ExtractorType extractor, Inspector&& inspector) : source(extractor), inspector(std::forward<Inspector>(inspector)) {}
+    struct EMPTY_BASES SpyStreamExtractor : StreamExtractor<SpyStreamExtractor<ExtractorType, Inspector>>, detail::FunctorStorage<Inspector> {
+        SpyStreamExtractor(ExtractorType extractor, Inspector&& inspector) : detail::FunctorStorage<Inspector>(std::forward<Inspector>(inspector)), source(std::move(extractor)) {}
 
         ExtractorType source;
-        Inspector inspector;
 
         auto get_impl() {
             auto value = source.get();
-            inspector(*value);
+            this->functor()(*value);
             return value;
         }
 
@@ -316,6 +599,16 @@ namespace streams {
             return source.advance();
         }
 
+        template<typename E = ExtractorType, typename = std::enable_if_t<traits::IsRandomAccess<E>::value>>
+        size_t remaining_impl() {
+            return source.remaining();
+        }
+
+        template<typename E = ExtractorType, typename = std::enable_if_t<traits::IsRandomAccess<E>::value>>
+        void jump_impl(size_t n) {
+            source.jump(n);
+        }
+
     };
 
 
@@ -334,7 +627,7 @@ namespace streams {
 
     template<typename ExtractorType>
     struct EnumerateStreamExtractor : StreamExtractor<EnumerateStreamExtractor<ExtractorType>> {
-        EnumerateStreamExtractor(ExtractorType extractor, size_t counter = 0) : source(extractor), counter(counter){}
+        EnumerateStreamExtractor(ExtractorType extractor, size_t counter = 0) : source(std::move(extractor)), counter(counter){}
 
         ExtractorType source;
         size_t counter;
@@ -350,12 +643,23 @@ namespace streams {
             return source.advance();
         }
 
+        template<typename E = ExtractorType, typename = std::enable_if_t<traits::IsRandomAccess<E>::value>>
+        size_t remaining_impl() {
+            return source.remaining();
+        }
+
+        template<typename E = ExtractorType, typename = std::enable_if_t<traits::IsRandomAccess<E>::value>>
+        void jump_impl(size_t n) {
+            counter += n;
+            source.jump(n);
+        }
+
     };
 
 
     template<typename ExtractorType>
     struct EnumerateTupleStreamExtractor : StreamExtractor<EnumerateTupleStreamExtractor<ExtractorType>> {
-        EnumerateTupleStreamExtractor(ExtractorType extractor, size_t counter = 0) : source(extractor), counter(counter) {}
+        EnumerateTupleStreamExtractor(ExtractorType extractor, size_t counter = 0) : source(std::move(extractor)), counter(counter) {}
 
         ExtractorType source;
         size_t counter;
@@ -371,22 +675,55 @@ namespace streams {
             return source.advance();
         }
 
+        template<typename E = ExtractorType, typename = std::enable_if_t<traits::IsRandomAccess<E>::value>>
+        size_t remaining_impl() {
+            return source.remaining();
+        }
+
+        template<typename E = ExtractorType, typename = std::enable_if_t<traits::IsRandomAccess<E>::value>>
+        void jump_impl(size_t n) {
+            counter += n;
+            source.jump(n);
+        }
+
     };
 
 
+    namespace detail {
+        // what a stream over several sources returns from get(): their common pointer type, or a
+        // ValuePointer holding a copy when any of them computes its elements
+        template<typename... Extractors>
+        struct CommonPointer {
+            static constexpr bool addressable = traits::AllOf<!IsValuePointer<decltype(std::declval<Extractors&>().get())>::value...>::value;
+
+            template<typename P, bool Addressable = addressable>
+            static std::enable_if_t<Addressable, std::common_type_t<decltype(&*std::declval<Extractors&>().get())...>> of(P&& p) {
+                return &*p;
+            }
+
+            template<typename P, bool Addressable = addressable>
+            static std::enable_if_t<!Addressable, ValuePointer<std::common_type_t<traits::ValueType<Extractors>...>>> of(P&& p) {
+                return { *p };
+            }
+
+            using type = decltype(of(std::declval<std::tuple_element_t<0, Tuple<Extractors...>>&>().get()));
+        };
+    }
+
     template<typename ExtractorType, typename ExtractorOtherType>
     struct ChainStreamExtractor : StreamExtractor<ChainStreamExtractor<ExtractorType, ExtractorOtherType>> {
-        ChainStreamExtractor(ExtractorType extractor, ExtractorOtherType other) : first(extractor), next(other){}
+        ChainStreamExtractor(ExtractorType extractor, ExtractorOtherType other) : first(std::move(extractor)), next(std::move(other)){}
 
         ExtractorType first;
         ExtractorOtherType next;
         bool firstHaveElements = true;
 
         auto get_impl() {
+            using Common = detail::CommonPointer<ExtractorType, ExtractorOtherType>;
             if (firstHaveElements) {
-                return first.get();
+                return Common::of(first.get());
             } else {
-                return next.get();
+                return Common::of(next.get());
             }
         }
 
@@ -402,7 +739,7 @@ namespace streams {
 
     template<typename ExtractorType, typename ExtractorOtherType>
     struct ZipStreamExtractor : StreamExtractor<ZipStreamExtractor<ExtractorType, ExtractorOtherType>> {
-        ZipStreamExtractor(ExtractorType extractor, ExtractorOtherType other) : left(extractor), right(other) {}
+        ZipStreamExtractor(ExtractorType extractor, ExtractorOtherType other) : left(std::move(extractor)), right(std::move(other)) {}
 
         ExtractorType left;
         ExtractorOtherType right;
@@ -417,283 +754,4205 @@ namespace streams {
             return left.advance() && right.advance();
         }
 
+        template<typename L = ExtractorType, typename R = ExtractorOtherType, typename = std::enable_if_t<traits::IsRandomAccess<L>::value && traits::IsRandomAccess<R>::value>>
+        size_t remaining_impl() {
+            return std::min(left.remaining(), right.remaining());
+        }
+
+        template<typename L = ExtractorType, typename R = ExtractorOtherType, typename = std::enable_if_t<traits::IsRandomAccess<L>::value && traits::IsRandomAccess<R>::value>>
+        void jump_impl(size_t n) {
+            left.jump(n);
+            right.jump(n);
+        }
+
     };
 
 
-    template<typename ExtractorType>
-    struct PurifyStreamExtractor : StreamExtractor<PurifyStreamExtractor<ExtractorType>> {
-        PurifyStreamExtractor(ExtractorType extractor) : source(extractor), value() {}
+    // zip(s1, ..., sN): one level for any N, yielding a flat Tuple
+    template<typename... Extractors>
+    struct ZipAllStreamExtractor : StreamExtractor<ZipAllStreamExtractor<Extractors...>> {
+        ZipAllStreamExtractor(Extractors... extractors) : sources(std::move(extractors)...) {}
 
-        ExtractorType source;
-        using source_optional_type = traits::ValueType<ExtractorType>;
-        static_assert(traits::IsOptional<source_optional_type>(), "Expected Optional<T> as a source");
-        using value_type = std::remove_const_t<typename source_optional_type::value_type>;
-        value_type value;
+        using Indices = std::index_sequence_for<Extractors...>;
+
+        Tuple<Extractors...> sources;
+        Tuple<traits::ValueType<Extractors>...> value {};
 
         auto get_impl() {
-            value = **source.get();
+            assign(Indices{});
             return &value;
         }
 
         bool advance_impl() {
-            while (source.advance()) {
-                if (*source.get() != nullopt) {
-                    return true;
-                }
-            }
-            return false;
+            return advanceAll(Indices{});
         }
 
-    };
-
-    template<typename ExtractorType>
-    struct BaseStreamInterface {
-        ExtractorType extractor;
-        using value_type = std::remove_reference_t<decltype(*extractor.get())>;
-
-        CONSTEXPR BaseStreamInterface(ExtractorType e) : extractor(e) {}
-
-        // Intermediate Operations
-
-        template<typename Transform>
-        auto map(Transform&& transform) {
-            using Extractor = MapStreamExtractor<decltype(extractor), Transform>;
-            return BaseStreamInterface<Extractor>(Extractor(extractor, std::forward<Transform>(transform)));
+        template<bool Enabled = traits::AllRandomAccess<Extractors...>::value, typename = std::enable_if_t<Enabled>>
+        size_t remaining_impl() {
+            return remainingAll(Indices{});
         }
 
-        // expects that std::begin and std::end can be called on the result of transform
-        template<typename Transform>
-        auto flatMap(Transform&& transform) {
-            using Extractor = FlatMapStreamExtractor<decltype(extractor), Transform>;
-            return BaseStreamInterface<Extractor>(Extractor(extractor, std::forward<Transform>(transform)));
+        template<bool Enabled = traits::AllRandomAccess<Extractors...>::value, typename = std::enable_if_t<Enabled>>
+        void jump_impl(size_t n) {
+            jumpAll(n, Indices{});
         }
 
-        // add flatten level
-        auto flatten() {
-            const auto flat = [](auto&& e) { return e; };
-            using Extractor = FlatMapStreamExtractor<decltype(extractor), decltype(flat)>;
-            return BaseStreamInterface<Extractor>(Extractor(extractor, std::move(flat)));
+        template<size_t... I>
+        void assign(std::index_sequence<I...>) {
+            value = Tuple<traits::ValueType<Extractors>...>(*std::get<I>(sources).get()...);
         }
 
-        template<typename Predicate>
-        auto filter(Predicate&& predicate) {
-            using Extractor = FilterStreamExtractor<decltype(extractor), Predicate>;
-            return BaseStreamInterface<Extractor>(Extractor(extractor, std::forward<Predicate>(predicate)));
+        template<size_t... I>
+        bool advanceAll(std::index_sequence<I...>) {
+            bool advanced = true;
+            (void)std::initializer_list<int>{ (advanced = advanced && std::get<I>(sources).advance(), 0)... };
+            return advanced;
         }
 
-        template<typename Transform>
-        auto filterMap(Transform&& transform) {
-            using Extractor = FilterMapStreamExtractor<decltype(extractor), Transform>;
-            return BaseStreamInterface<Extractor>(Extractor(extractor, std::forward<Transform>(transform)));
+        template<size_t... I>
+        size_t remainingAll(std::index_sequence<I...>) {
+            return std::min({ std::get<I>(sources).remaining()... });
         }
 
-        auto skip(size_t count) {
-            using Extractor = SkipFirstStreamExtractor<decltype(extractor)>;
-            return BaseStreamInterface<Extractor>(Extractor(extractor, count));
+        template<size_t... I>
+        void jumpAll(size_t n, std::index_sequence<I...>) {
+            (void)std::initializer_list<int>{ (std::get<I>(sources).jump(n), 0)... };
         }
+    };
 
-        template<typename Predicate>
-        auto skipWhile(Predicate&& predicate) {
-            using Extractor = SkipWhileStreamExtractor<decltype(extractor), Predicate>;
-            return BaseStreamInterface<Extractor>(Extractor(extractor, std::forward<Predicate>(predicate)));
-        }
 
-        auto take(size_t count) {
-            using Extractor = TakeStreamExtractor<decltype(extractor)>;
-            return BaseStreamInterface<Extractor>(Extractor(extractor, count));
-        }
+    // chain(s1, ..., sN): one level for any N; the active source is an index into tables of
+    // per-source functions, so each call costs one indirect call instead of a walk down N - 1
+    // nested firstHaveElements checks
+    template<typename... Extractors>
+    struct ChainAllStreamExtractor : StreamExtractor<ChainAllStreamExtractor<Extractors...>> {
+        ChainAllStreamExtractor(Extractors... extractors) : sources(std::move(extractors)...) {}
 
-        template<typename Predicate>
-        auto takeWhile(Predicate&& predicate) {
-            using Extractor = TakeWhileStreamExtractor<decltype(extractor), Predicate>;
-            return BaseStreamInterface<Extractor>(Extractor(extractor, std::forward<Predicate>(predicate)));
+        using Indices = std::index_sequence_for<Extractors...>;
+        using Sources = Tuple<Extractors...>;
+        using Pointer = typename detail::CommonPointer<Extractors...>::type;
+
+        Sources sources;
+        size_t active = 0;
+
+        template<size_t I>
+        static Pointer getAt(Sources& sources) {
+            return detail::CommonPointer<Extractors...>::of(std::get<I>(sources).get());
         }
 
-        template<typename Inspector>
-        auto inspect(Inspector&& inspector) {
-            using Extractor = InspectStreamExtractor<decltype(extractor), Inspector>;
-            return BaseStreamInterface<Extractor>(Extractor(extractor, std::forward<Inspector>(inspector)));
+        template<size_t I>
+        static bool advanceAt(Sources& sources) {
+            return std::get<I>(sources).advance();
         }
 
-        template<typename Inspector>
-        auto spy(Inspector&& inspector) {
-            using Extractor = SpyStreamExtractor<decltype(extractor), Inspector>;
-            return BaseStreamInterface<Extractor>(Extractor(extractor, std::forward<Inspector>(inspector)));
+        template<size_t I>
+        static size_t remainingAt(Sources& sources) {
+            return std::get<I>(sources).remaining();
         }
 
-        auto enumerate(size_t from = 0) {
-            using Extractor = EnumerateStreamExtractor<decltype(extractor)>;
-            return BaseStreamInterface<Extractor>(Extractor(extractor, from));
+        template<size_t I>
+        static void jumpAt(Sources& sources, size_t n) {
+            std::get<I>(sources).jump(n);
         }
 
-        auto enumerateTup(size_t from = 0) {
-            using Extractor = EnumerateTupleStreamExtractor<decltype(extractor)>;
-            return BaseStreamInterface<Extractor>(Extractor(extractor, from));
+        template<size_t... I>
+        static auto getTable(std::index_sequence<I...>) {
+            static Pointer (* const table[])(Sources&) = { &getAt<I>... };
+            return table;
         }
 
-        template <template<typename> class StreamOther, typename OtherExtractor>
-        auto chain(StreamOther<OtherExtractor> other) {
-            using Extractor = ChainStreamExtractor<decltype(extractor), OtherExtractor>;
-            return BaseStreamInterface<Extractor>(Extractor(extractor, other.extractor));
+        template<size_t... I>
+        static auto advanceTable(std::index_sequence<I...>) {
+            static bool (* const table[])(Sources&) = { &advanceAt<I>... };
+            return table;
         }
 
-        template <template<typename> class StreamOther, typename OtherExtractor>
-        auto zip(StreamOther<OtherExtractor> other) {
-            using Extractor = ZipStreamExtractor<decltype(extractor), OtherExtractor>;
-            return BaseStreamInterface<Extractor>(Extractor(extractor, other.extractor));
+        template<size_t... I>
+        static auto remainingTable(std::index_sequence<I...>) {
+            static size_t (* const table[])(Sources&) = { &remainingAt<I>... };
+            return table;
         }
 
-        auto purify() {
-            static_assert(traits::IsOptional<value_type>(), "Purify should be called on a stream of Optional<T> values");
-            using Extractor = PurifyStreamExtractor<decltype(extractor)>;
-            return BaseStreamInterface<Extractor>(Extractor(extractor));
+        template<size_t... I>
+        static auto jumpTable(std::index_sequence<I...>) {
+            static void (* const table[])(Sources&, size_t) = { &jumpAt<I>... };
+            return table;
         }
 
-        // Non-Terminal
+        Pointer get_impl() {
+            return getTable(Indices{})[active](sources);
+        }
 
-        Optional<value_type> next() {
-            if (extractor.advance()) {
-                return{ *extractor.get() };
+        bool advance_impl() {
+            for (; active != sizeof...(Extractors); ++active) {
+                if (advanceTable(Indices{})[active](sources)) {
+                    return true;
+                }
             }
-            return{};
+            active = sizeof...(Extractors) - 1; // depleted, but get() stays valid
+            return false;
         }
 
-        Optional<value_type> nth(size_t n) {
-            while (n && extractor.advance()) {
-                --n;
+        template<bool Enabled = traits::AllRandomAccess<Extractors...>::value, typename = std::enable_if_t<Enabled>>
+        size_t remaining_impl() {
+            size_t total = 0;
+            for (size_t i = active; i != sizeof...(Extractors); ++i) {
+                const size_t left = remainingTable(Indices{})[i](sources);
+                total = left > std::numeric_limits<size_t>::max() - total ? std::numeric_limits<size_t>::max() : total + left;
             }
-            return next();
+            return total;
         }
-        // Terminal Operations 
 
-        Optional<value_type> last() {
-            if (!extractor.advance()) {
-                return nullopt;
-            } else {
-                auto ptr = extractor.get();
-                while (extractor.advance()) {
-                    ptr = extractor.get();
-                }				
-                return *ptr;			
+        template<bool Enabled = traits::AllRandomAccess<Extractors...>::value, typename = std::enable_if_t<Enabled>>
+        void jump_impl(size_t n) {
+            for (size_t i = active; n != 0 && i != sizeof...(Extractors); ++i) {
+                const size_t step = std::min(n, remainingTable(Indices{})[i](sources));
+                jumpTable(Indices{})[i](sources, step);
+                n -= step;
             }
         }
+    };
 
-        template<typename Callable>
-        void forEach(Callable&& callable) {
-            while (extractor.advance()) {
-                callable(*extractor.get());
-            }
+
+    // scan(init, op): init op e1, (init op e1) op e2, ...
+    template<typename ExtractorType, typename Accumulator, typename Operation>
+    struct EMPTY_BASES ScanStreamExtractor : StreamExtractor<ScanStreamExtractor<ExtractorType, Accumulator, Operation>>, detail::FunctorStorage<Operation> {
+        ScanStreamExtractor(ExtractorType extractor, Accumulator init, Operation&& op)
+            : detail::FunctorStorage<Operation>(std::forward<Operation>(op)), source(std::move(extractor)), accumulator(std::move(init)) {}
+
+        ExtractorType source;
+        Accumulator accumulator;
+
+        Accumulator* get_impl() {
+            return &accumulator;
         }
 
-        size_t count() {
-            size_t counter = 0;
-            while (extractor.advance()) {
-                ++counter;
+        bool advance_impl() {
+            if (!source.advance()) {
+                return false;
             }
-            return counter;
+            accumulator = this->functor()(accumulator, *source.get());
+            return true;
         }
+    };
 
-        template<typename Predicate>
-        bool any(Predicate&& predicate) {
-            while (extractor.advance()) {
-                if (predicate(*extractor.get())) {
-                    return true;
-                }
-            }
-            return false;
+    // scanExclusive(init, op): init, init op e1, ... - the aggregate before each element
+    template<typename ExtractorType, typename Accumulator, typename Operation>
+    struct EMPTY_BASES ScanExclusiveStreamExtractor : StreamExtractor<ScanExclusiveStreamExtractor<ExtractorType, Accumulator, Operation>>, detail::FunctorStorage<Operation> {
+        ScanExclusiveStreamExtractor(ExtractorType extractor, Accumulator init, Operation&& op)
+            : detail::FunctorStorage<Operation>(std::forward<Operation>(op)), source(std::move(extractor)), accumulator(std::move(init)) {}
+
+        ExtractorType source;
+        Accumulator accumulator;
+        Accumulator previous {};
+
+        Accumulator* get_impl() {
+            return &previous;
         }
 
-        template<typename Predicate>
-        bool all(Predicate&& predicate) {
-            while (extractor.advance()) {
-                if (!predicate(*extractor.get())) {
-                    return false;
-                }
+        bool advance_impl() {
+            if (!source.advance()) {
+                return false;
             }
+            previous = accumulator;
+            accumulator = this->functor()(accumulator, *source.get());
             return true;
         }
+    };
+
+
+    template<typename ExtractorType>
+    struct PurifyStreamExtractor : StreamExtractor<PurifyStreamExtractor<ExtractorType>> {
+        PurifyStreamExtractor(ExtractorType extractor) : source(std::move(extractor)), value() {}
+
+        ExtractorType source;
+        using source_optional_type = traits::ValueType<ExtractorType>;
+        static_assert(traits::IsOptional<source_optional_type>(), "Expected Optional<T> as a source");
+        using value_type = std::remove_const_t<typename source_optional_type::value_type>;
+        value_type value;
+
+        auto get_impl() {
+            value = **source.get();
+            return &value;
+        }
+
+        bool advance_impl() {
+            while (source.advance()) {
+                if (*source.get() != nullopt) {
+                    return true;
+                }
+            }
+            return false;
+        }
+
+    };
+
+
+    // A row of fromColumns(): one shared index into every column, so a stage reads only the
+    // columns it asks for and nothing is copied out of them.
+    template<typename... Iterators>
+    struct Row {
+        Tuple<Iterators...> columns;
+        size_t index;
+
+        template<size_t Column>
+        decltype(auto) get() const {
+            using Difference = typename std::iterator_traits<std::tuple_element_t<Column, Tuple<Iterators...>>>::difference_type;
+            return std::get<Column>(columns)[static_cast<Difference>(index)];
+        }
+    };
+
+    template<size_t Column, typename... Iterators>
+    decltype(auto) get(const Row<Iterators...>& row) {
+        return row.template get<Column>();
+    }
+
+    template<typename... Iterators>
+    struct ColumnsStreamExtractor : StreamExtractor<ColumnsStreamExtractor<Iterators...>> {
+        static_assert(sizeof...(Iterators) != 0, "at least one column is expected");
+
+        ColumnsStreamExtractor(Tuple<Iterators...> begins, size_t size, size_t next = 0) : row{ begins, 0 }, size(size), next(next) {}
+
+        Row<Iterators...> row;
+        size_t size;
+        size_t next;
+
+        auto get_impl() noexcept {
+            return &row;
+        }
+
+        bool advance_impl() noexcept {
+            if (next == size) {
+                return false;
+            }
+            row.index = next++;
+            return true;
+        }
+
+        size_t remaining_impl() const noexcept {
+            return size - next;
+        }
+
+        void jump_impl(size_t n) noexcept {
+            next += n;
+        }
+
+        // the same rows, restricted to the given columns
+        template<size_t... Columns>
+        auto project() const {
+            using Extractor = ColumnsStreamExtractor<std::tuple_element_t<Columns, Tuple<Iterators...>>...>;
+            return Extractor(std::make_tuple(std::get<Columns>(row.columns)...), size, next);
+        }
+    };
+
+
+    // k-way merge of sorted sources over a loser tree: tree[0] holds the current winner,
+    // tree[1..k-1] hold the losers of each match, so a refill replays only one leaf-to-root path
+    template<typename ExtractorType, typename Comparator>
+    struct MergeSortedStreamExtractor : StreamExtractor<MergeSortedStreamExtractor<ExtractorType, Comparator>> {
+        MergeSortedStreamExtractor(std::vector<ExtractorType> extractors, Comparator cmp)
+            : sources(std::move(extractors)), comparator(cmp), alive(sources.size(), false), tree(sources.size(), sources.size()) {}
+
+        std::vector<ExtractorType> sources;
+        Comparator comparator;
+        std::vector<bool> alive;
+        std::vector<size_t> tree;
+        bool started = false;
+
+        auto get_impl() {
+            return sources[tree[0]].get();
+        }
+
+        bool advance_impl() {
+            if (sources.empty()) {
+                return false;
+            }
+            if (!started) {
+                started = true;
+                for (size_t i = 0; i < sources.size(); ++i) {
+                    alive[i] = sources[i].advance();
+                    replay(i);
+                }
+            } else {
+                const size_t winner = tree[0];
+                if (alive[winner]) {
+                    alive[winner] = sources[winner].advance();
+                }
+                replay(winner);
+            }
+            return alive[tree[0]];
+        }
+
+        // depleted sources lose every match; ties go to the lower index so the merge is stable
+        bool beats(size_t lhs, size_t rhs) {
+            if (!alive[lhs] || !alive[rhs]) {
+                return alive[lhs];
+            }
+            if (lhs < rhs) {
+                return !comparator(*sources[rhs].get(), *sources[lhs].get());
+            }
+            return comparator(*sources[lhs].get(), *sources[rhs].get());
+        }
+
+        void replay(size_t winner) {
+            const size_t empty = sources.size(); // only seen while the tree is being built
+            for (size_t node = (winner + sources.size()) / 2; node > 0; node /= 2) {
+                if (tree[node] == empty) {
+                    tree[node] = winner;
+                    return;
+                }
+                if (beats(tree[node], winner)) {
+                    std::swap(tree[node], winner);
+                }
+            }
+            tree[0] = winner;
+        }
+
+    };
+
+    namespace detail {
+        inline uint64_t mix64(uint64_t x) noexcept {
+            x ^= x >> 30;
+            x *= 0xbf58476d1ce4e5b9ULL;
+            x ^= x >> 27;
+            x *= 0x94d049bb133111ebULL;
+            return x ^ (x >> 31);
+        }
+
+        // small, fast and seedable; good enough for sampling decisions, not for cryptography
+        struct SplitMix64 {
+            explicit SplitMix64(uint64_t seed = 0) : state(seed) {}
+
+            uint64_t state;
+
+            uint64_t next() noexcept {
+                return mix64(state += 0x9e3779b97f4a7c15ULL);
+            }
+
+            // uniform in (0, 1]
+            double nextDouble() noexcept {
+                return static_cast<double>((next() >> 11) + 1) * (1.0 / 9007199254740992.0);
+            }
+
+            // uniform in [0, bound)
+            uint64_t nextBelow(uint64_t bound) noexcept {
+                const double unit = static_cast<double>(next() >> 11) * (1.0 / 9007199254740992.0);
+                return std::min(static_cast<uint64_t>(unit * static_cast<double>(bound)), bound - 1);
+            }
+        };
+
+        inline unsigned leadingZeros(uint64_t x) noexcept {
+#if defined __GNUC__
+            return x ? static_cast<unsigned>(__builtin_clzll(x)) : 64;
+#else
+            unsigned n = 0;
+            for (uint64_t bit = 1ULL << 63; bit && !(x & bit); bit >>= 1) {
+                ++n;
+            }
+            return n;
+#endif
+        }
+    } // namespace detail
+
+
+    // keeps each element with probability p, independently; instead of a draw per element it draws
+    // the geometric gap to the next kept one and skips it, jumping over random-access sources
+    template<typename ExtractorType>
+    struct SampleStreamExtractor : StreamExtractor<SampleStreamExtractor<ExtractorType>> {
+        SampleStreamExtractor(ExtractorType extractor, double p, uint64_t seed)
+            : source(std::move(extractor)), random(seed), logSkip(p < 1 ? std::log1p(-p) : 0), empty(!(p > 0)) {}
+
+        ExtractorType source;
+        detail::SplitMix64 random;
+        double logSkip; // log(1 - p)
+        bool empty;
+
+        auto get_impl() {
+            return source.get();
+        }
+
+        bool advance_impl() {
+            return !empty && detail::skipElements(source, nextGap()) && source.advance();
+        }
+
+        size_t nextGap() {
+            if (logSkip == 0) {
+                return 0;
+            }
+            const double gap = std::floor(std::log(random.nextDouble()) / logSkip);
+            return gap < static_cast<double>(std::numeric_limits<size_t>::max()) ? static_cast<size_t>(gap) : std::numeric_limits<size_t>::max();
+        }
+
+    };
+
+
+    // Fixed-size summaries. Each one can be filled independently (per thread, per shard)
+    // and combined afterwards with merge().
+    namespace sketch {
+
+        // distinct count estimate with a relative error of about 1.04 / sqrt(2^precision)
+        struct HyperLogLog {
+            explicit HyperLogLog(unsigned precision = 12) : precision(precision), registers(size_t(1) << precision, 0) {
+                assert(precision >= 4 && precision <= 18);
+            }
+
+            unsigned precision;
+            std::vector<uint8_t> registers;
+
+            template<typename T>
+            void add(const T& value) {
+                addHash(detail::mix64(std::hash<T>{}(value)));
+            }
+
+            void addHash(uint64_t hash) noexcept {
+                const size_t index = static_cast<size_t>(hash >> (64 - precision));
+                const uint8_t rank = static_cast<uint8_t>(std::min(detail::leadingZeros(hash << precision), 64 - precision) + 1);
+                registers[index] = std::max(registers[index], rank);
+            }
+
+            void merge(const HyperLogLog& other) {
+                assert(precision == other.precision);
+                for (size_t i = 0; i < registers.size(); ++i) {
+                    registers[i] = std::max(registers[i], other.registers[i]);
+                }
+            }
+
+            double estimate() const {
+                const double m = static_cast<double>(registers.size());
+                double sum = 0;
+                size_t zeros = 0;
+                for (auto r : registers) {
+                    sum += std::ldexp(1.0, -r);
+                    zeros += r == 0;
+                }
+                const double alpha = 0.7213 / (1 + 1.079 / m);
+                const double raw = alpha * m * m / sum;
+                if (raw <= 2.5 * m && zeros != 0) {
+                    return m * std::log(m / static_cast<double>(zeros)); // linear counting for small cardinalities
+                }
+                return raw;
+            }
+        };
+
+
+        // KLL quantile sketch: level h holds items of weight 2^h, and a full level is sorted and
+        // every other item is promoted, so memory stays at O(k) items for any stream length
+        template<typename T>
+        struct Quantiles {
+            explicit Quantiles(size_t k = 200, uint64_t seed = 0) : k(std::max<size_t>(k, 8)), random(seed), levels(1) {}
+
+            size_t k;
+            detail::SplitMix64 random;
+            std::vector<std::vector<T>> levels;
+            size_t items = 0;
+            size_t total = 0;
+            T minimum {};
+            T maximum {};
+
+            void add(const T& value) {
+                if (total == 0 || value < minimum) {
+                    minimum = value;
+                }
+                if (total == 0 || maximum < value) {
+                    maximum = value;
+                }
+                levels[0].push_back(value);
+                ++items;
+                ++total;
+                compress();
+            }
+
+            void merge(const Quantiles& other) {
+                if (other.total == 0) {
+                    return;
+                }
+                if (total == 0 || other.minimum < minimum) {
+                    minimum = other.minimum;
+                }
+                if (total == 0 || maximum < other.maximum) {
+                    maximum = other.maximum;
+                }
+                if (levels.size() < other.levels.size()) {
+                    levels.resize(other.levels.size());
+                }
+                for (size_t h = 0; h < other.levels.size(); ++h) {
+                    levels[h].insert(levels[h].end(), other.levels[h].begin(), other.levels[h].end());
+                }
+                items += other.items;
+                total += other.total;
+                compress();
+            }
+
+            size_t count() const noexcept {
+                return total;
+            }
+
+            // q in [0, 1], the extremes are exact; the sketch should not be empty
+            T quantile(double q) const {
+                return quantiles({ q }).front();
+            }
+
+            std::vector<T> quantiles(const std::vector<double>& qs) const {
+                std::vector<std::pair<T, uint64_t>> weighted;
+                weighted.reserve(items);
+                for (size_t h = 0; h < levels.size(); ++h) {
+                    for (auto& e : levels[h]) {
+                        weighted.emplace_back(e, uint64_t(1) << h);
+                    }
+                }
+                std::sort(weighted.begin(), weighted.end(), [](auto& lhs, auto& rhs) { return lhs.first < rhs.first; });
+                uint64_t weight = 0;
+                for (auto& e : weighted) {
+                    weight += e.second;
+                }
+
+                std::vector<T> result;
+                result.reserve(qs.size());
+                for (double q : qs) {
+                    if (q <= 0 || q >= 1) {
+                        result.push_back(q <= 0 ? minimum : maximum);
+                        continue;
+                    }
+                    const double rank = q * static_cast<double>(weight);
+                    uint64_t cumulative = 0;
+                    auto it = weighted.begin();
+                    while (it + 1 != weighted.end() && static_cast<double>(cumulative + it->second) < rank) {
+                        cumulative += it->second;
+                        ++it;
+                    }
+                    result.push_back(it->first);
+                }
+                return result;
+            }
+
+            size_t capacity(size_t h) const {
+                const double depth = static_cast<double>(levels.size() - h - 1);
+                return std::max<size_t>(2, static_cast<size_t>(std::ceil(k * std::pow(2.0 / 3.0, depth))));
+            }
+
+            void compress() {
+                for (size_t h = 0; h < levels.size(); ++h) {
+                    if (levels[h].size() < capacity(h)) {
+                        continue;
+                    }
+                    if (h + 1 == levels.size()) {
+                        levels.emplace_back();
+                    }
+                    auto& level = levels[h];
+                    std::sort(level.begin(), level.end());
+                    const size_t paired = level.size() & ~size_t(1);
+                    for (size_t i = random.next() & 1; i < paired; i += 2) {
+                        levels[h + 1].push_back(level[i]);
+                    }
+                    items -= paired / 2;
+                    level.erase(level.begin(), level.begin() + paired);
+                }
+            }
+        };
+
+
+        // uniform sample of k elements without replacement (Li's algorithm L, which draws
+        // skip lengths, so the random generator runs O(k log(n/k)) times rather than n)
+        template<typename T>
+        struct Reservoir {
+            explicit Reservoir(size_t k, uint64_t seed = 0) : k(k), random(seed) {
+                items.reserve(k);
+            }
+
+            size_t k;
+            detail::SplitMix64 random;
+            std::vector<T> items;
+            size_t seen = 0;
+            size_t nextReplaced = 0;
+            double w = 1.0;
+
+            void add(const T& value) {
+                if (items.size() < k) {
+                    items.push_back(value);
+                    if (items.size() == k) {
+                        w = std::exp(std::log(random.nextDouble()) / static_cast<double>(k));
+                        drawSkip(seen + 1);
+                    }
+                } else if (seen == nextReplaced && k != 0) {
+                    items[random.nextBelow(k)] = value;
+                    w *= std::exp(std::log(random.nextDouble()) / static_cast<double>(k));
+                    drawSkip(seen + 1);
+                }
+                ++seen;
+            }
+
+            // how many items come from each side is a hypergeometric draw over the populations seen,
+            // the items themselves are then picked uniformly from each side's sample, so both sides
+            // must keep the same k: a smaller sample could run out of items to pick
+            void merge(const Reservoir& other) {
+                assert(k == other.k && this != &other);
+                std::vector<T> left = std::move(items);
+                std::vector<T> right = other.items;
+                size_t leftRemaining = seen;
+                size_t rightRemaining = other.seen;
+                items.clear();
+                while (items.size() < k && leftRemaining + rightRemaining != 0) {
+                    const bool fromLeft = random.nextBelow(leftRemaining + rightRemaining) < leftRemaining;
+                    auto& from = fromLeft ? left : right;
+                    --(fromLeft ? leftRemaining : rightRemaining);
+                    auto pick = from.begin() + static_cast<std::ptrdiff_t>(random.nextBelow(from.size()));
+                    items.push_back(std::move(*pick));
+                    *pick = std::move(from.back());
+                    from.pop_back();
+                }
+                seen += other.seen;
+                // the exact threshold is lost in a merge, continue from its expected value k / (n + 1)
+                w = std::min(1.0, static_cast<double>(k) / static_cast<double>(seen + 1));
+                drawSkip(seen);
+            }
+
+            void drawSkip(size_t from) {
+                if (items.size() < k || w >= 1.0) {
+                    nextReplaced = from;
+                    return;
+                }
+                const double skip = std::floor(std::log(random.nextDouble()) / std::log1p(-w));
+                nextReplaced = from + (skip < 1e18 ? static_cast<size_t>(skip) : size_t(1e18));
+            }
+        };
+
+    } // namespace sketch
+
+
+    // count, sum, mean, variance, min and max gathered in one pass. Elements are taken in blocks:
+    // each block is reduced in independent lanes (which the compiler can vectorize without
+    // reassociating floating-point sums), then folded in with Chan's pairwise update, the sum
+    // itself being Neumaier-compensated. Merging the same partials in the same order always gives
+    // the same result, no matter which threads produced them. min and max are meaningful for count != 0.
+    template<typename T>
+    struct Summary {
+        static_assert(std::is_arithmetic<T>::value, "Summary expects arithmetic elements");
+
+        static constexpr size_t blockSize = 64;
+        static constexpr size_t lanes = 8;
+
+        size_t count = 0;
+        double mean = 0;
+        double m2 = 0;
+        T min {};
+        T max {};
+        double sumHigh = 0;
+        double sumLow = 0;
+
+        double sum() const noexcept {
+            return sumHigh + sumLow;
+        }
+
+        double variance() const noexcept {
+            return count != 0 ? m2 / static_cast<double>(count) : 0.0;
+        }
+
+        double sampleVariance() const noexcept {
+            return count > 1 ? m2 / static_cast<double>(count - 1) : 0.0;
+        }
+
+        double stddev() const noexcept {
+            return std::sqrt(variance());
+        }
+
+        void add(T value) {
+            addBlock(&value, 1);
+        }
+
+        void addBlock(const T* values, size_t n) {
+            while (n > blockSize) {
+                addBlock(values, blockSize);
+                values += blockSize;
+                n -= blockSize;
+            }
+            if (n == 0) {
+                return;
+            }
+
+            double sums[lanes] = {};
+            T mins[lanes];
+            T maxs[lanes];
+            std::fill(mins, mins + lanes, values[0]);
+            std::fill(maxs, maxs + lanes, values[0]);
+            const size_t full = n - n % lanes;
+            for (size_t i = 0; i < full; i += lanes) {
+                for (size_t j = 0; j < lanes; ++j) {
+                    sums[j] += static_cast<double>(values[i + j]);
+                    mins[j] = values[i + j] < mins[j] ? values[i + j] : mins[j];
+                    maxs[j] = maxs[j] < values[i + j] ? values[i + j] : maxs[j];
+                }
+            }
+            for (size_t i = full; i < n; ++i) {
+                sums[0] += static_cast<double>(values[i]);
+                mins[0] = values[i] < mins[0] ? values[i] : mins[0];
+                maxs[0] = maxs[0] < values[i] ? values[i] : maxs[0];
+            }
+
+            Summary block;
+            block.count = n;
+            for (size_t j = 0; j < lanes; ++j) {
+                block.addToSum(sums[j]);
+            }
+            block.min = *std::min_element(mins, mins + lanes);
+            block.max = *std::max_element(maxs, maxs + lanes);
+            block.mean = block.sum() / static_cast<double>(n);
+
+            double squares[lanes] = {};
+            for (size_t i = 0; i < full; i += lanes) {
+                for (size_t j = 0; j < lanes; ++j) {
+                    const double d = static_cast<double>(values[i + j]) - block.mean;
+                    squares[j] += d * d;
+                }
+            }
+            for (size_t i = full; i < n; ++i) {
+                const double d = static_cast<double>(values[i]) - block.mean;
+                squares[0] += d * d;
+            }
+            for (size_t j = 0; j < lanes; ++j) {
+                block.m2 += squares[j];
+            }
+            merge(block);
+        }
+
+        void merge(const Summary& other) {
+            if (other.count == 0) {
+                return;
+            }
+            if (count == 0) {
+                *this = other;
+                return;
+            }
+            const double n = static_cast<double>(count);
+            const double m = static_cast<double>(other.count);
+            const double delta = other.mean - mean;
+            count += other.count;
+            mean += delta * m / (n + m);
+            m2 += other.m2 + delta * delta * n * m / (n + m);
+            min = other.min < min ? other.min : min;
+            max = max < other.max ? other.max : max;
+            addToSum(other.sumHigh);
+            addToSum(other.sumLow);
+        }
+
+        void addToSum(double value) noexcept {
+            const double t = sumHigh + value;
+            if (std::abs(sumHigh) >= std::abs(value)) {
+                sumLow += (sumHigh - t) + value;
+            } else {
+                sumLow += (value - t) + sumHigh;
+            }
+            sumHigh = t;
+        }
+    };
+
+
+    // Incremental window aggregates for windowByTime. An aggregator spec is bound to the element
+    // type; the bound aggregator sees add() for every event entering the window and evict() for
+    // every event leaving it, always in arrival order, and never re-scans the window.
+    namespace aggregators {
+
+        struct Identity {
+            template<typename T>
+            const T& operator()(const T& value) const noexcept {
+                return value;
+            }
+        };
+
+        struct Count {
+            template<typename T>
+            struct Aggregator {
+                size_t counter = 0;
+
+                void add(const T&) noexcept {
+                    ++counter;
+                }
+
+                void evict(const T&) noexcept {
+                    --counter;
+                }
+
+                size_t result() const noexcept {
+                    return counter;
+                }
+            };
+
+            template<typename T>
+            Aggregator<T> bind() const {
+                return {};
+            }
+        };
+
+        // invertible: subtracts what leaves the window
+        template<typename Field>
+        struct SumSpec {
+            Field field;
+
+            template<typename T>
+            struct Aggregator {
+                Field field;
+                std::decay_t<decltype(std::declval<Field>()(std::declval<const T&>()))> total {};
+
+                void add(const T& e) {
+                    total += field(e);
+                }
+
+                void evict(const T& e) {
+                    total -= field(e);
+                }
+
+                auto result() const {
+                    return total;
+                }
+            };
+
+            template<typename T>
+            Aggregator<T> bind() const {
+                return { field };
+            }
+        };
+
+        template<typename Field>
+        struct MeanSpec {
+            Field field;
+
+            template<typename T>
+            struct Aggregator {
+                typename SumSpec<Field>::template Aggregator<T> sum;
+                size_t counter = 0;
+
+                void add(const T& e) {
+                    sum.add(e);
+                    ++counter;
+                }
+
+                void evict(const T& e) {
+                    sum.evict(e);
+                    --counter;
+                }
+
+                double result() const {
+                    return static_cast<double>(sum.result()) / static_cast<double>(counter);
+                }
+            };
+
+            template<typename T>
+            Aggregator<T> bind() const {
+                return { { field } };
+            }
+        };
+
+        // not invertible: a monotonic deque keeps only the values that can still become the
+        // extreme of a later window, tagged with their arrival number so evict() is O(1) amortized
+        template<typename Field, typename Comparator>
+        struct ExtremeSpec {
+            Field field;
+            Comparator cmp;
+
+            template<typename T>
+            struct Aggregator {
+                Field field;
+                Comparator cmp;
+                using value_type = std::decay_t<decltype(std::declval<Field>()(std::declval<const T&>()))>;
+                std::deque<std::pair<size_t, value_type>> candidates {};
+                size_t added = 0;
+                size_t evicted = 0;
+
+                void add(const T& e) {
+                    value_type v = field(e);
+                    while (!candidates.empty() && !cmp(candidates.back().second, v)) {
+                        candidates.pop_back();
+                    }
+                    candidates.emplace_back(added++, std::move(v));
+                }
+
+                void evict(const T&) {
+                    if (!candidates.empty() && candidates.front().first == evicted) {
+                        candidates.pop_front();
+                    }
+                    ++evicted;
+                }
+
+                value_type result() const {
+                    return candidates.front().second;
+                }
+            };
+
+            template<typename T>
+            Aggregator<T> bind() const {
+                return { field, cmp };
+            }
+        };
+
+        inline Count count() {
+            return {};
+        }
+
+        template<typename Field = Identity>
+        SumSpec<std::decay_t<Field>> sum(Field&& field = {}) {
+            return { std::forward<Field>(field) };
+        }
+
+        template<typename Field = Identity>
+        MeanSpec<std::decay_t<Field>> mean(Field&& field = {}) {
+            return { std::forward<Field>(field) };
+        }
+
+        template<typename Field = Identity>
+        ExtremeSpec<std::decay_t<Field>, std::less<>> min(Field&& field = {}) {
+            return { std::forward<Field>(field), {} };
+        }
+
+        template<typename Field = Identity>
+        ExtremeSpec<std::decay_t<Field>, std::greater<>> max(Field&& field = {}) {
+            return { std::forward<Field>(field), {} };
+        }
+
+    } // namespace aggregators
+
+
+    template<typename Timestamp, typename T>
+    struct Window {
+        Timestamp begin;
+        Timestamp end;
+        T value;
+    };
+
+    template<typename Timestamp, typename T>
+    bool operator == (const Window<Timestamp, T>& lhs, const Window<Timestamp, T>& rhs) {
+        return lhs.begin == rhs.begin && lhs.end == rhs.end && lhs.value == rhs.value;
+    }
+
+    namespace detail {
+        template<typename T>
+        std::enable_if_t<std::is_integral<T>::value, T> floorDiv(T a, T b) {
+            return a / b - ((a % b != 0) && ((a < 0) != (b < 0)));
+        }
+
+        template<typename T>
+        std::enable_if_t<!std::is_integral<T>::value, T> floorDiv(T a, T b) {
+            return std::floor(a / b);
+        }
+
+        // for a, b > 0
+        template<typename T>
+        std::enable_if_t<std::is_integral<T>::value, T> ceilDiv(T a, T b) {
+            return a / b + (a % b != 0);
+        }
+
+        template<typename T>
+        std::enable_if_t<!std::is_integral<T>::value, T> ceilDiv(T a, T b) {
+            return std::ceil(a / b);
+        }
+    }
+
+    // Windows [k * slide, k * slide + size) over events that arrive in timestamp order. Each
+    // event is added to the aggregator once and evicted once; only the events of the current
+    // window are kept. Windows without events are skipped, events older than the current window
+    // are dropped.
+    template<typename ExtractorType, typename TimestampFn, typename Aggregator, typename Timestamp>
+    struct WindowByTimeStreamExtractor : StreamExtractor<WindowByTimeStreamExtractor<ExtractorType, TimestampFn, Aggregator, Timestamp>> {
+        WindowByTimeStreamExtractor(ExtractorType extractor, TimestampFn&& ts, Timestamp size, Timestamp slide, Aggregator aggregator)
+            : source(std::move(extractor)), timestamp(std::forward<TimestampFn>(ts)), size(size), slide(slide), aggregator(std::move(aggregator)) {}
+
+        using Element = traits::ValueType<ExtractorType>;
+        using Event = std::pair<Timestamp, Element>;
+
+        ExtractorType source;
+        TimestampFn timestamp;
+        Timestamp size;
+        Timestamp slide;
+        Aggregator aggregator;
+        std::deque<Event> events {};
+        Optional<Event> pending {};
+        bool started = false;
+        Window<Timestamp, decltype(std::declval<const Aggregator&>().result())> value {};
+
+        auto get_impl() {
+            return &value;
+        }
+
+        bool advance_impl() {
+            if (!started) {
+                started = true;
+                pull();
+                value.begin = pending ? firstWindowOf(pending->first) : Timestamp{};
+            } else if (pending || !events.empty()) {
+                value.begin += slide;
+                while (!events.empty() && events.front().first < value.begin) {
+                    aggregator.evict(events.front().second);
+                    events.pop_front();
+                }
+            }
+            if (events.empty()) {
+                // skip the empty windows, and the events that no window covers (slide > size)
+                while (pending && firstWindowOf(pending->first) > pending->first) {
+                    pull();
+                }
+                if (!pending) {
+                    return false;
+                }
+                value.begin = std::max(value.begin, firstWindowOf(pending->first));
+            }
+            value.end = value.begin + size;
+            while (pending && pending->first < value.end) {
+                if (!(pending->first < value.begin)) {
+                    aggregator.add(pending->second);
+                    events.push_back(std::move(*pending));
+                }
+                pull();
+            }
+            value.value = aggregator.result();
+            return true;
+        }
+
+        void pull() {
+            if (source.advance()) {
+                auto e = source.get();
+                pending = Event(timestamp(*e), *e);
+            } else {
+                pending = nullopt;
+            }
+        }
+
+        // the first window ending after ts, found from the window that starts at or before ts:
+        // ts - size would wrap for unsigned timestamps, whose windows start at 0 at the earliest
+        Timestamp firstWindowOf(Timestamp ts) const {
+            const Timestamp k = detail::floorDiv<Timestamp>(ts, slide);
+            const Timestamp offset = ts - k * slide;
+            if (!(offset < size)) {
+                return (k + 1) * slide;
+            }
+            Timestamp back = detail::ceilDiv<Timestamp>(size - offset, slide) - 1;
+            if (std::is_unsigned<Timestamp>::value) {
+                back = std::min(back, k);
+            }
+            return (k - back) * slide;
+        }
+    };
+
+
+    // First-class versions of the terminal operations, so several of them can share one pass
+    // (see BaseStreamInterface::fanout). A collector spec is bound to the element type, then
+    // accept() is fed with elements until it returns false (the collector retires) or the
+    // stream is depleted, and result() gives the same value as the matching terminal.
+    namespace collectors {
+
+        struct Count {
+            template<typename T>
+            struct Collector {
+                size_t counter = 0;
+
+                bool accept(const T&) noexcept {
+                    ++counter;
+                    return true;
+                }
+
+                size_t result() noexcept {
+                    return counter;
+                }
+            };
+
+            template<typename T>
+            Collector<T> bind() const {
+                return {};
+            }
+        };
+
+        template<typename Accumulator, typename Fold>
+        struct FoldSpec {
+            Accumulator init;
+            Fold fold;
+
+            template<typename T>
+            struct Collector {
+                Accumulator a;
+                Fold fold;
+
+                bool accept(const T& e) {
+                    a = fold(a, e);
+                    return true;
+                }
+
+                Accumulator result() {
+                    return a;
+                }
+            };
+
+            template<typename T>
+            Collector<T> bind() const {
+                return { init, fold };
+            }
+        };
+
+        template<typename Comparator>
+        struct MinSpec {
+            Comparator cmp;
+
+            template<typename T>
+            struct Collector {
+                Comparator cmp;
+                Optional<T> value {};
+
+                bool accept(const T& e) {
+                    if (!value || cmp(e, *value)) {
+                        value = e;
+                    }
+                    return true;
+                }
+
+                Optional<T> result() {
+                    return value;
+                }
+            };
+
+            template<typename T>
+            Collector<T> bind() const {
+                return { cmp };
+            }
+        };
+
+        template<typename Predicate>
+        struct AnySpec {
+            Predicate predicate;
+
+            template<typename T>
+            struct Collector {
+                Predicate predicate;
+                bool found = false;
+
+                bool accept(const T& e) {
+                    found = predicate(e);
+                    return !found;
+                }
+
+                bool result() noexcept {
+                    return found;
+                }
+            };
+
+            template<typename T>
+            Collector<T> bind() const {
+                return { predicate };
+            }
+        };
+
+        template<typename Predicate>
+        struct AllSpec {
+            Predicate predicate;
+
+            template<typename T>
+            struct Collector {
+                Predicate predicate;
+                bool holds = true;
+
+                bool accept(const T& e) {
+                    holds = predicate(e);
+                    return holds;
+                }
+
+                bool result() noexcept {
+                    return holds;
+                }
+            };
+
+            template<typename T>
+            Collector<T> bind() const {
+                return { predicate };
+            }
+        };
+
+        template<template<class...> class Container>
+        struct CollectSpec {
+            template<typename T>
+            struct Collector {
+                Container<T> container {};
+
+                bool accept(const T& e) {
+                    container.push_back(e);
+                    return true;
+                }
+
+                Container<T> result() {
+                    return std::move(container);
+                }
+            };
+
+            template<typename T>
+            Collector<T> bind() const {
+                return {};
+            }
+        };
+
+        template<typename Predicate, template<class...> class Container>
+        struct PartitionSpec {
+            Predicate predicate;
+
+            template<typename T>
+            struct Collector {
+                Predicate predicate;
+                std::pair<Container<T>, Container<T>> pair {};
+
+                bool accept(const T& e) {
+                    if (predicate(e)) {
+                        pair.first.push_back(e);
+                    } else {
+                        pair.second.push_back(e);
+                    }
+                    return true;
+                }
+
+                std::pair<Container<T>, Container<T>> result() {
+                    return std::move(pair);
+                }
+            };
+
+            template<typename T>
+            Collector<T> bind() const {
+                return { predicate };
+            }
+        };
+
+        template<typename Predicate>
+        struct FindSpec {
+            Predicate predicate;
+
+            template<typename T>
+            struct Collector {
+                Predicate predicate;
+                Optional<T> value {};
+
+                bool accept(const T& e) {
+                    if (predicate(e)) {
+                        value = e;
+                        return false;
+                    }
+                    return true;
+                }
+
+                Optional<T> result() {
+                    return value;
+                }
+            };
+
+            template<typename T>
+            Collector<T> bind() const {
+                return { predicate };
+            }
+        };
+
+        inline Count count() {
+            return {};
+        }
+
+        template<typename Accumulator, typename Fold>
+        FoldSpec<Accumulator, std::decay_t<Fold>> fold(Accumulator a, Fold&& fold) {
+            return { a, std::forward<Fold>(fold) };
+        }
+
+        template<typename Comparator = std::less<>>
+        MinSpec<Comparator> min(Comparator cmp = {}) {
+            return { cmp };
+        }
+
+        template<typename Comparator = std::greater<>>
+        MinSpec<Comparator> max(Comparator cmp = {}) {
+            return { cmp };
+        }
+
+        template<typename Predicate>
+        AnySpec<std::decay_t<Predicate>> any(Predicate&& predicate) {
+            return { std::forward<Predicate>(predicate) };
+        }
+
+        template<typename Predicate>
+        AllSpec<std::decay_t<Predicate>> all(Predicate&& predicate) {
+            return { std::forward<Predicate>(predicate) };
+        }
+
+        template<template<class...> class Container = std::vector>
+        CollectSpec<Container> collect() {
+            return {};
+        }
+
+        template<template<class...> class Container = std::vector, typename Predicate>
+        PartitionSpec<std::decay_t<Predicate>, Container> partition(Predicate&& predicate) {
+            return { std::forward<Predicate>(predicate) };
+        }
+
+        template<typename Predicate>
+        FindSpec<std::decay_t<Predicate>> find(Predicate&& predicate) {
+            return { std::forward<Predicate>(predicate) };
+        }
+
+    } // namespace collectors
+
+    namespace detail {
+        template<typename Collectors, typename T, size_t... I>
+        void fanoutAccept(Collectors& collectors, bool* active, size_t& remaining, const T& e, std::index_sequence<I...>) {
+            (void)std::initializer_list<int>{ (active[I] && !std::get<I>(collectors).accept(e) ? (active[I] = false, --remaining, 0) : 0)... };
+        }
+
+        template<typename Collectors, size_t... I>
+        auto fanoutResults(Collectors& collectors, std::index_sequence<I...>) {
+            return Tuple<decltype(std::get<I>(collectors).result())...>(std::get<I>(collectors).result()...);
+        }
+
+        // a staging line of one cache line per bucket: elements reach their bucket a line at a
+        // time, so the scattered stores stay few and the flush branch stays predictable
+        template<typename T>
+        struct ScatterBuffers {
+            static constexpr size_t lineSize = sizeof(T) < 64 ? 64 / sizeof(T) : 1;
+
+            explicit ScatterBuffers(size_t k) : lines(k * lineSize), fill(k, 0) {}
+
+            std::vector<T> lines;
+            std::vector<size_t> fill;
+
+            void add(std::vector<std::vector<T>>& buckets, size_t bucket, const T& value) {
+                T* line = lines.data() + bucket * lineSize;
+                line[fill[bucket]++] = value;
+                if (fill[bucket] == lineSize) {
+                    buckets[bucket].insert(buckets[bucket].end(), line, line + lineSize);
+                    fill[bucket] = 0;
+                }
+            }
+
+            void flush(std::vector<std::vector<T>>& buckets) {
+                for (size_t bucket = 0; bucket != buckets.size(); ++bucket) {
+                    const T* line = lines.data() + bucket * lineSize;
+                    buckets[bucket].insert(buckets[bucket].end(), line, line + fill[bucket]);
+                    fill[bucket] = 0;
+                }
+            }
+        };
+
+        // only a bare random-access container is walked twice: a stage above it would run its
+        // functor twice per element
+        template<typename Extractor>
+        struct IsReIterable : std::false_type {};
+
+        template<typename Iterator>
+        struct IsReIterable<SequenceStreamExtractor<Iterator>> : traits::IsRandomAccess<SequenceStreamExtractor<Iterator>> {};
+
+        // a source that can be walked twice gets a histogram pass first, so that every bucket is
+        // allocated once at its final size; the bucket of each element is kept from that pass
+        template<typename Extractor, typename T, typename BucketFn>
+        void partitionInto(Extractor& extractor, std::vector<std::vector<T>>& buckets, BucketFn& bucketOf, std::true_type /* re-iterable */) {
+            Extractor pass = extractor;
+            std::vector<uint32_t> ids;
+            ids.reserve(pass.remaining());
+            std::vector<size_t> counts(buckets.size(), 0);
+            while (pass.advance()) {
+                const size_t bucket = bucketOf(*pass.get());
+                assert(bucket < buckets.size());
+                ids.push_back(static_cast<uint32_t>(bucket));
+                ++counts[bucket];
+            }
+            for (size_t bucket = 0; bucket != buckets.size(); ++bucket) {
+                buckets[bucket].reserve(counts[bucket]);
+            }
+
+            ScatterBuffers<T> buffers(buckets.size());
+            for (size_t i = 0; extractor.advance(); ++i) {
+                buffers.add(buckets, ids[i], *extractor.get());
+            }
+            buffers.flush(buckets);
+        }
+
+        template<typename Extractor, typename T, typename BucketFn>
+        void partitionInto(Extractor& extractor, std::vector<std::vector<T>>& buckets, BucketFn& bucketOf, std::false_type /* single pass */) {
+            ScatterBuffers<T> buffers(buckets.size());
+            while (extractor.advance()) {
+                auto e = extractor.get();
+                const size_t bucket = bucketOf(*e);
+                assert(bucket < buckets.size());
+                buffers.add(buckets, bucket, *e);
+            }
+            buffers.flush(buckets);
+        }
+    } // namespace detail
+
+
+    namespace detail {
+        // digits of v, written backwards ending at `end`; returns the first character
+        inline char* formatUnsigned(char* end, uint64_t v) noexcept {
+            do {
+                *--end = static_cast<char>('0' + v % 10);
+                v /= 10;
+            } while (v != 0);
+            return end;
+        }
+
+        inline float readFloating(const char* text, float) { return std::strtof(text, nullptr); }
+        inline double readFloating(const char* text, double) { return std::strtod(text, nullptr); }
+        inline long double readFloating(const char* text, long double) { return std::strtold(text, nullptr); }
+
+        // shortest text that reads back as the same value of type T (so 0.1f is "0.1")
+        template<typename T>
+        size_t formatFloating(char* out, size_t capacity, T value) {
+#if defined __cpp_lib_to_chars
+            return static_cast<size_t>(std::to_chars(out, out + capacity, value).ptr - out);
+#else
+            int written = 0;
+            for (int precision = std::numeric_limits<T>::digits10; precision <= std::numeric_limits<T>::max_digits10; ++precision) {
+                written = std::snprintf(out, capacity, "%.*Lg", precision, static_cast<long double>(value));
+                if (readFloating(out, value) == value) {
+                    break;
+                }
+            }
+            return static_cast<size_t>(written);
+#endif
+        }
+    }
+
+    namespace detail {
+        template<typename Writer>
+        void appendText(Writer& writer, char value) {
+            *writer.reserve(1) = value;
+            writer.commit(1);
+        }
+
+        template<typename Writer>
+        void appendText(Writer& writer, const char* value) {
+            writer.append(value, std::strlen(value));
+        }
+
+        template<typename Writer>
+        void appendText(Writer& writer, const std::string& value) {
+            writer.append(value.data(), value.size());
+        }
+
+        template<typename Writer>
+        void appendText(Writer& writer, StringView value) {
+            writer.append(value.data(), value.size());
+        }
+
+        template<typename Writer, typename T>
+        std::enable_if_t<std::is_integral<T>::value> appendText(Writer& writer, T value) {
+            char digits[24];
+            char* end = digits + sizeof(digits);
+            const bool negative = value < T(0);
+            const uint64_t magnitude = negative ? uint64_t(0) - static_cast<uint64_t>(value) : static_cast<uint64_t>(value);
+            char* first = formatUnsigned(end, magnitude);
+            if (negative) {
+                *--first = '-';
+            }
+            writer.append(first, static_cast<size_t>(end - first));
+        }
+
+        template<typename Writer, typename T>
+        std::enable_if_t<std::is_floating_point<T>::value> appendText(Writer& writer, T value) {
+            writer.commit(formatFloating(writer.reserve(64), 64, value));
+        }
+
+        // anything else goes through its operator <<
+        template<typename Writer, typename T>
+        std::enable_if_t<!std::is_arithmetic<T>::value> appendText(Writer& writer, const T& value) {
+            std::ostringstream os;
+            os << value;
+            appendText(writer, os.str());
+        }
+    }
+
+    namespace io {
+
+        struct WriteOptions {
+            size_t bufferSize = size_t(1) << 16;
+            bool background = false; // format into one buffer while a writer thread writes the other
+        };
+
+        struct ReadOptions {
+            size_t chunkSize = size_t(1) << 20; // rounded up to a multiple of 4 KiB
+            unsigned queueDepth = 4; // chunks being read at once with io_uring
+            bool direct = false; // O_DIRECT, bypassing the page cache where the file system allows it
+            bool uring = true; // io_uring when the kernel offers it, pread() otherwise
+        };
+
+#if defined __unix__ || defined __APPLE__
+        // Buffered writer over a file descriptor. Data is gathered in a large buffer and written
+        // with few write() calls; an append larger than the buffer goes out in one writev()
+        // together with what is buffered, without being copied. Never throws, see ok().
+        struct FdWriter {
+            FdWriter(int fd, WriteOptions options = {})
+                : fd(fd), capacity(std::max<size_t>(options.bufferSize, 64)), background(options.background) {
+                buffers[0].resize(capacity);
+                if (background) {
+                    buffers[1].resize(capacity);
+                    thread = std::thread([this] { writerLoop(); });
+                }
+            }
+
+            FdWriter(const FdWriter&) = delete;
+            FdWriter& operator = (const FdWriter&) = delete;
+
+            ~FdWriter() {
+                finish();
+            }
+
+            int fd;
+            size_t capacity;
+            bool background;
+            std::vector<char> buffers[2];
+            size_t current = 0;
+            size_t used = 0;
+            bool failed = false;
+
+            std::thread thread;
+            std::mutex mutex;
+            std::condition_variable condition;
+            const char* pendingData = nullptr; // a buffer handed over to the writer thread
+            size_t pending = 0;
+            bool stopping = false;
+
+            // room for at least n <= capacity bytes at the returned position, see commit()
+            char* reserve(size_t n) {
+                if (capacity - used < n) {
+                    flushBuffer();
+                }
+                return buffers[current].data() + used;
+            }
+
+            void commit(size_t n) noexcept {
+                used += n;
+            }
+
+            void append(const char* data, size_t n) {
+                if (n <= capacity - used) {
+                    std::memcpy(buffers[current].data() + used, data, n);
+                    used += n;
+                } else if (!background && n >= capacity / 2) {
+                    iovec parts[2] = { { buffers[current].data(), used }, { const_cast<char*>(data), n } };
+                    writeAll(parts, 2);
+                    used = 0;
+                } else {
+                    while (n != 0) {
+                        if (used == capacity) {
+                            flushBuffer();
+                        }
+                        const size_t chunk = std::min(n, capacity - used);
+                        std::memcpy(buffers[current].data() + used, data, chunk);
+                        used += chunk;
+                        data += chunk;
+                        n -= chunk;
+                    }
+                }
+            }
+
+            // everything written so far and the writer thread stopped; false if any write failed
+            bool finish() {
+                flushBuffer();
+                if (thread.joinable()) {
+                    {
+                        std::unique_lock<std::mutex> lock(mutex);
+                        condition.wait(lock, [this] { return pending == 0; });
+                        stopping = true;
+                    }
+                    condition.notify_all();
+                    thread.join();
+                }
+                return ok();
+            }
+
+            bool ok() {
+                std::lock_guard<std::mutex> lock(mutex);
+                return !failed;
+            }
+
+            void flushBuffer() {
+                if (used == 0) {
+                    return;
+                }
+                if (!background) {
+                    iovec part = { buffers[current].data(), used };
+                    writeAll(&part, 1);
+                } else {
+                    {
+                        std::unique_lock<std::mutex> lock(mutex);
+                        condition.wait(lock, [this] { return pending == 0; });
+                        pendingData = buffers[current].data();
+                        pending = used;
+                    }
+                    condition.notify_all();
+                    current ^= 1;
+                }
+                used = 0;
+            }
+
+            void writerLoop() {
+                std::unique_lock<std::mutex> lock(mutex);
+                while (true) {
+                    condition.wait(lock, [this] { return pending != 0 || stopping; });
+                    if (pending == 0) {
+                        return;
+                    }
+                    iovec part = { const_cast<char*>(pendingData), pending };
+                    lock.unlock();
+                    const bool written = writeParts(&part, 1);
+                    lock.lock();
+                    failed |= !written;
+                    pending = 0;
+                    condition.notify_all();
+                }
+            }
+
+            void writeAll(iovec* parts, int count) {
+                if (!writeParts(parts, count)) {
+                    std::lock_guard<std::mutex> lock(mutex);
+                    failed = true;
+                }
+            }
+
+            // retries partial writes and interrupted calls
+            bool writeParts(iovec* parts, int count) const {
+                while (true) {
+                    while (count != 0 && parts[0].iov_len == 0) {
+                        ++parts;
+                        --count;
+                    }
+                    if (count == 0) {
+                        return true;
+                    }
+                    const ssize_t written = ::writev(fd, parts, count);
+                    if (written < 0 && errno == EINTR) {
+                        continue;
+                    }
+                    if (written <= 0) {
+                        return false;
+                    }
+                    size_t left = static_cast<size_t>(written);
+                    while (left != 0 && left >= parts[0].iov_len) {
+                        left -= parts[0].iov_len;
+                        ++parts;
+                        --count;
+                    }
+                    if (left != 0) {
+                        parts[0].iov_base = static_cast<char*>(parts[0].iov_base) + left;
+                        parts[0].iov_len -= left;
+                    }
+                }
+            }
+        };
+#endif
+
+#if defined STREAMS_IO_URING
+        // The few io_uring calls a reader needs, through the raw system calls: queue a readv,
+        // wait for one completion. Not thread-safe; false from setup() when the kernel refuses.
+        struct Uring {
+            Uring() = default;
+            Uring(const Uring&) = delete;
+            Uring& operator = (const Uring&) = delete;
+
+            ~Uring() {
+                if (sqes != nullptr) {
+                    ::munmap(sqes, sqesSize);
+                }
+                if (cqRing != nullptr && cqRing != sqRing) {
+                    ::munmap(cqRing, cqRingSize);
+                }
+                if (sqRing != nullptr) {
+                    ::munmap(sqRing, sqRingSize);
+                }
+                if (fd >= 0) {
+                    ::close(fd);
+                }
+            }
+
+            int fd = -1;
+            void* sqRing = nullptr;
+            void* cqRing = nullptr;
+            io_uring_sqe* sqes = nullptr;
+            size_t sqRingSize = 0;
+            size_t cqRingSize = 0;
+            size_t sqesSize = 0;
+            unsigned* sqTail = nullptr;
+            unsigned* sqArray = nullptr;
+            unsigned sqMask = 0;
+            unsigned* cqHead = nullptr;
+            unsigned* cqTail = nullptr;
+            unsigned cqMask = 0;
+            io_uring_cqe* cqes = nullptr;
+
+            bool setup(unsigned entries) {
+                io_uring_params params;
+                std::memset(&params, 0, sizeof(params));
+                fd = static_cast<int>(::syscall(__NR_io_uring_setup, entries, &params));
+                if (fd < 0) {
+                    return false;
+                }
+                sqRingSize = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+                cqRingSize = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+                const bool single = (params.features & IORING_FEAT_SINGLE_MMAP) != 0;
+                if (single) {
+                    sqRingSize = cqRingSize = std::max(sqRingSize, cqRingSize);
+                }
+                sqRing = map(sqRingSize, IORING_OFF_SQ_RING);
+                cqRing = single ? sqRing : map(cqRingSize, IORING_OFF_CQ_RING);
+                sqesSize = params.sq_entries * sizeof(io_uring_sqe);
+                sqes = static_cast<io_uring_sqe*>(map(sqesSize, IORING_OFF_SQES));
+                if (sqRing == nullptr || cqRing == nullptr || sqes == nullptr) {
+                    return false;
+                }
+                char* sq = static_cast<char*>(sqRing);
+                char* cq = static_cast<char*>(cqRing);
+                sqTail = reinterpret_cast<unsigned*>(sq + params.sq_off.tail);
+                sqArray = reinterpret_cast<unsigned*>(sq + params.sq_off.array);
+                sqMask = *reinterpret_cast<unsigned*>(sq + params.sq_off.ring_mask);
+                cqHead = reinterpret_cast<unsigned*>(cq + params.cq_off.head);
+                cqTail = reinterpret_cast<unsigned*>(cq + params.cq_off.tail);
+                cqMask = *reinterpret_cast<unsigned*>(cq + params.cq_off.ring_mask);
+                cqes = reinterpret_cast<io_uring_cqe*>(cq + params.cq_off.cqes);
+                return true;
+            }
+
+            void* map(size_t size, off_t offset) {
+                void* p = ::mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, offset);
+                return p == MAP_FAILED ? nullptr : p;
+            }
+
+            // never more reads in flight than entries, so the submission queue has room
+            bool readv(int file, const iovec* part, uint64_t offset, uint64_t tag) {
+                const unsigned tail = *sqTail;
+                const unsigned index = tail & sqMask;
+                io_uring_sqe& sqe = sqes[index];
+                std::memset(&sqe, 0, sizeof(sqe));
+                sqe.opcode = IORING_OP_READV;
+                sqe.fd = file;
+                sqe.addr = reinterpret_cast<uint64_t>(part);
+                sqe.len = 1;
+                sqe.off = offset;
+                sqe.user_data = tag;
+                sqArray[index] = index;
+                __atomic_store_n(sqTail, tail + 1, __ATOMIC_RELEASE);
+                return enter(1, 0, 0) >= 0;
+            }
+
+            // blocks for the next completion
+            bool wait(uint64_t& tag, int& result) {
+                for (;;) {
+                    const unsigned head = *cqHead;
+                    if (head != __atomic_load_n(cqTail, __ATOMIC_ACQUIRE)) {
+                        const io_uring_cqe& cqe = cqes[head & cqMask];
+                        tag = cqe.user_data;
+                        result = cqe.res;
+                        __atomic_store_n(cqHead, head + 1, __ATOMIC_RELEASE);
+                        return true;
+                    }
+                    if (enter(0, 1, IORING_ENTER_GETEVENTS) < 0) {
+                        return false;
+                    }
+                }
+            }
+
+            int enter(unsigned submit, unsigned complete, unsigned flags) {
+                for (;;) {
+                    const long entered = ::syscall(__NR_io_uring_enter, fd, submit, complete, flags, nullptr, 0);
+                    if (entered >= 0 || errno != EINTR) {
+                        return static_cast<int>(entered);
+                    }
+                }
+            }
+        };
+#endif
+
+#if defined __unix__ || defined __APPLE__
+        // Reads a file in fixed-size chunks, handed out in file order. With io_uring the next
+        // queueDepth - 1 chunks are already being read while the current one is processed;
+        // otherwise each chunk is read with pread() when it is asked for. Never throws, see failed.
+        constexpr size_t alignment = 4096; // what O_DIRECT asks of buffers, offsets and sizes
+
+        struct ChunkReader {
+            ChunkReader(const std::string& path, ReadOptions options = {})
+                : chunkSize(std::max<size_t>((options.chunkSize + alignment - 1) / alignment * alignment, alignment))
+                , depth(std::max(options.queueDepth, 1u)) {
+                int flags = O_RDONLY | O_CLOEXEC;
+#if defined O_DIRECT
+                if (options.direct) {
+                    fd = ::open(path.c_str(), flags | O_DIRECT);
+                }
+#endif
+                direct = fd >= 0;
+                if (fd < 0) {
+                    fd = ::open(path.c_str(), flags); // also where O_DIRECT is not supported
+                }
+                slots.resize(depth);
+                for (auto& slot : slots) {
+                    void* buffer = nullptr;
+                    if (::posix_memalign(&buffer, alignment, chunkSize) != 0) {
+                        buffer = nullptr;
+                    }
+                    slot.part.iov_base = buffer;
+                    slot.part.iov_len = chunkSize;
+                    failed |= buffer == nullptr;
+                }
+                failed |= fd < 0;
+#if defined STREAMS_IO_URING
+                if (!failed && options.uring && uring.setup(depth)) {
+                    usingUring = true;
+                    for (size_t i = 0; i != depth; ++i) {
+                        submit(i);
+                    }
+                }
+#endif
+            }
+
+            ChunkReader(const ChunkReader&) = delete;
+            ChunkReader& operator = (const ChunkReader&) = delete;
+
+            ~ChunkReader() {
+#if defined STREAMS_IO_URING
+                // the kernel may still be writing into the buffers
+                uint64_t tag;
+                int result;
+                while (inFlight != 0 && uring.wait(tag, result)) {
+                    --inFlight;
+                }
+#endif
+                for (auto& slot : slots) {
+                    std::free(slot.part.iov_base);
+                }
+                if (fd >= 0) {
+                    ::close(fd);
+                }
+            }
+
+            struct Slot {
+                iovec part {};
+                ssize_t result = 0;
+                bool done = false;
+            };
+
+            int fd = -1;
+            size_t chunkSize;
+            size_t depth;
+            std::vector<Slot> slots;
+            size_t next = 0; // index of the chunk handed out by the next call
+            bool finished = false;
+            bool failed = false;
+            bool usingUring = false;
+            bool direct = false; // then a short read is the end of the file
+#if defined STREAMS_IO_URING
+            Uring uring;
+            size_t inFlight = 0;
+#endif
+
+            // the next chunk, valid until the following call; false at the end or on an error
+            bool read(const char*& data, size_t& size) {
+                if (finished || failed) {
+                    return false;
+                }
+                if (next != 0 && usingUring) {
+                    submit(next - 1 + depth); // into the slot of the chunk just processed
+                }
+                Slot& slot = slots[next % depth];
+                if (usingUring) {
+                    wait(slot);
+                } else {
+                    slot.result = readAt(slot, 0, static_cast<off_t>(next * chunkSize));
+                }
+                if (slot.result > 0 && static_cast<size_t>(slot.result) < chunkSize && usingUring && !direct) {
+                    slot.result = readAt(slot, static_cast<size_t>(slot.result), static_cast<off_t>(next * chunkSize)); // a short read
+                }
+                failed = slot.result < 0;
+                finished = slot.result <= 0 || static_cast<size_t>(slot.result) < chunkSize;
+                ++next;
+                data = static_cast<const char*>(slot.part.iov_base);
+                size = slot.result > 0 ? static_cast<size_t>(slot.result) : 0;
+                return size != 0;
+            }
+
+            // fills the slot from `from` on with pread(); the total read or -1
+            ssize_t readAt(Slot& slot, size_t from, off_t offset) {
+                char* buffer = static_cast<char*>(slot.part.iov_base);
+                while (from != chunkSize) {
+                    const ssize_t n = ::pread(fd, buffer + from, chunkSize - from, offset + static_cast<off_t>(from));
+                    if (n < 0 && errno == EINTR) {
+                        continue;
+                    }
+                    if (n < 0) {
+                        return -1;
+                    }
+                    from += static_cast<size_t>(n);
+                    if (n == 0 || direct) {
+                        break;
+                    }
+                }
+                return static_cast<ssize_t>(from);
+            }
+
+#if defined STREAMS_IO_URING
+            void submit(size_t chunk) {
+                Slot& slot = slots[chunk % depth];
+                slot.done = false;
+                if (uring.readv(fd, &slot.part, chunk * chunkSize, chunk)) {
+                    ++inFlight;
+                } else {
+                    slot.result = -1;
+                    slot.done = true;
+                }
+            }
+
+            void wait(Slot& slot) {
+                uint64_t tag;
+                int result;
+                while (!slot.done) {
+                    if (!uring.wait(tag, result)) {
+                        slot.result = -1;
+                        return;
+                    }
+                    --inFlight;
+                    Slot& completed = slots[tag % depth];
+                    completed.result = result;
+                    completed.done = true;
+                }
+            }
+#else
+            void submit(size_t) {}
+            void wait(Slot&) {}
+#endif
+        };
+#endif
+
+    } // namespace io
+
+    // Opt-in timeline recording, exported as Chrome trace-event JSON (chrome://tracing, Perfetto).
+    // Every thread writes to a ring of its own without locks or atomic read-modify-writes; a full
+    // ring overwrites its oldest events. Export once the traced work is done. Names must outlive
+    // the export (string literals).
+    namespace trace {
+        struct Event {
+            const char* name;
+            char phase; // 'b'/'e' batch spans, 'C' counters, 'i' instants
+            uint32_t thread;
+            uint64_t time; // ns since enable()
+            uint64_t id;
+            int64_t value;
+        };
+
+        struct Ring {
+            Ring(uint32_t thread, size_t capacity) : thread(thread), events(capacity) {}
+
+            const uint32_t thread;
+            std::vector<Event> events;
+            std::atomic<size_t> written { 0 };
+
+            void push(const Event& event) {
+                const size_t n = written.load(std::memory_order_relaxed);
+                events[n % events.size()] = event;
+                written.store(n + 1, std::memory_order_release);
+            }
+        };
+
+        struct Registry {
+            std::mutex mutex; // taken when a thread records for the first time and on export
+            std::vector<std::unique_ptr<Ring>> rings;
+            std::atomic<bool> enabled { false };
+            std::atomic<uint64_t> ids { 0 };
+            std::chrono::steady_clock::time_point epoch = std::chrono::steady_clock::now();
+            size_t capacity = size_t(1) << 14;
+        };
+
+        inline Registry& registry() {
+            static Registry instance;
+            return instance;
+        }
+
+        inline bool enabled() {
+            return registry().enabled.load(std::memory_order_relaxed);
+        }
+
+        // drops what was recorded before
+        inline void enable(size_t eventsPerThread = size_t(1) << 14) {
+            Registry& r = registry();
+            std::lock_guard<std::mutex> lock(r.mutex);
+            for (auto& ring : r.rings) {
+                ring->written.store(0, std::memory_order_relaxed);
+            }
+            r.capacity = std::max<size_t>(eventsPerThread, 1);
+            r.epoch = std::chrono::steady_clock::now();
+            r.enabled.store(true, std::memory_order_release);
+        }
+
+        inline void disable() {
+            registry().enabled.store(false, std::memory_order_release);
+        }
+
+        inline uint64_t nextId() {
+            return registry().ids.fetch_add(1, std::memory_order_relaxed) + 1;
+        }
+
+        inline Ring& threadRing() {
+            static thread_local Ring* ring = nullptr;
+            if (ring == nullptr) {
+                Registry& r = registry();
+                std::lock_guard<std::mutex> lock(r.mutex);
+                r.rings.push_back(std::make_unique<Ring>(static_cast<uint32_t>(r.rings.size() + 1), r.capacity));
+                ring = r.rings.back().get();
+            }
+            return *ring;
+        }
+
+        inline void record(const char* name, char phase, uint64_t id = 0, int64_t value = 0) {
+            if (!enabled()) {
+                return;
+            }
+            Ring& ring = threadRing();
+            const auto elapsed = std::chrono::steady_clock::now() - registry().epoch;
+            ring.push({ name, phase, ring.thread, static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count()), id, value });
+        }
+
+        inline void counter(const char* name, int64_t value) {
+            record(name, 'C', 0, value);
+        }
+
+        inline void instant(const char* name) {
+            record(name, 'i');
+        }
+
+        inline void appendEscaped(std::string& out, const char* text) {
+            for (; *text != '\0'; ++text) {
+                if (*text == '"' || *text == '\\') {
+                    out += '\\';
+                }
+                out += static_cast<unsigned char>(*text) < 0x20 ? ' ' : *text;
+            }
+        }
+
+        // the recorded events as a Chrome trace-event document
+        inline std::string json() {
+            Registry& r = registry();
+            std::lock_guard<std::mutex> lock(r.mutex);
+            std::string out = "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[";
+            bool first = true;
+            char number[64];
+            for (auto& ring : r.rings) {
+                const size_t written = ring->written.load(std::memory_order_acquire);
+                const size_t size = ring->events.size();
+                for (size_t i = written > size ? written - size : 0; i != written; ++i) {
+                    const Event& event = ring->events[i % size];
+                    out += first ? "{\"name\":\"" : ",\n{\"name\":\"";
+                    first = false;
+                    appendEscaped(out, event.name);
+                    std::snprintf(number, sizeof(number), "\",\"ph\":\"%c\",\"pid\":1,\"tid\":%u,\"ts\":%.3f", event.phase,
+                                  static_cast<unsigned>(event.thread), static_cast<double>(event.time) / 1000.0);
+                    out += number;
+                    if (event.phase == 'b' || event.phase == 'e') {
+                        std::snprintf(number, sizeof(number), ",\"cat\":\"stream\",\"id\":%llu", static_cast<unsigned long long>(event.id));
+                        out += number;
+                    } else if (event.phase == 'C') {
+                        std::snprintf(number, sizeof(number), ",\"args\":{\"value\":%lld}", static_cast<long long>(event.value));
+                        out += number;
+                    } else if (event.phase == 'i') {
+                        out += ",\"s\":\"t\"";
+                    }
+                    out += '}';
+                }
+            }
+            out += "]}\n";
+            return out;
+        }
+
+        inline bool save(const std::string& path) {
+            const std::string document = json();
+            FILE* file = std::fopen(path.c_str(), "wb");
+            if (file == nullptr) {
+                return false;
+            }
+            const bool written = std::fwrite(document.data(), 1, document.size(), file) == document.size();
+            return std::fclose(file) == 0 && written;
+        }
+    } // namespace trace
+
+    namespace detail {
+        // the T in "... [with T = streams::FilterStreamExtractor<...>]"
+        inline std::string templateArgumentName(const std::string& signature) {
+            const size_t begin = signature.find("T = ") + 4;
+            return signature.substr(begin, signature.find_first_of("<;]", begin) - begin);
+        }
+
+        // "streams::FilterStreamExtractor" for FilterStreamExtractor<...>, where the compiler tells
+        template<typename T>
+        const char* templateName() {
+#if defined __GNUC__
+            static const std::string name = templateArgumentName(__PRETTY_FUNCTION__);
+            return name.c_str();
+#else
+            return "stage";
+#endif
+        }
+    }
+
+    // .label(): while tracing is on, every batch of elements pulled through this point is a span
+    // of its own on the timeline, from the first advance() of the batch to the last
+    template<typename ExtractorType>
+    struct LabelStreamExtractor : StreamExtractor<LabelStreamExtractor<ExtractorType>> {
+        LabelStreamExtractor(ExtractorType extractor, const char* name, size_t batch)
+            : source(std::move(extractor)), name(name), id(trace::nextId()), batch(std::max<size_t>(batch, 1)) {}
+
+        ExtractorType source;
+        const char* name;
+        uint64_t id;
+        size_t batch;
+        size_t pulled = 0;
+
+        auto get_impl() {
+            return source.get();
+        }
+
+        bool advance_impl() {
+            if (!trace::enabled()) {
+                return source.advance();
+            }
+            if (pulled == 0) {
+                trace::record(name, 'b', id);
+            }
+            const bool advanced = source.advance();
+            if (!advanced || ++pulled == batch) {
+                trace::record(name, 'e', id);
+                pulled = 0;
+            }
+            return advanced;
+        }
+
+        template<typename E = ExtractorType, typename = std::enable_if_t<traits::IsRandomAccess<E>::value>>
+        size_t remaining_impl() {
+            return source.remaining();
+        }
+
+        template<typename E = ExtractorType, typename = std::enable_if_t<traits::IsRandomAccess<E>::value>>
+        void jump_impl(size_t n) {
+            source.jump(n);
+        }
+    };
+
+
+    namespace detail {
+        inline size_t workerCount(size_t threads) {
+            return threads != 0 ? threads : std::max<size_t>(std::thread::hardware_concurrency(), 1);
+        }
+
+        // runs body(worker) for every worker in [0, workers), each on its own thread, the calling
+        // one included. The first exception thrown calls stop(), so that the others can give up
+        // early, and is rethrown here once every thread has been joined.
+        template<typename Body, typename Stop>
+        void runWorkers(size_t workers, Body& body, Stop&& stop) {
+            std::exception_ptr failure;
+            std::mutex lock;
+            auto fail = [&](std::exception_ptr exception) {
+                std::lock_guard<std::mutex> guard(lock);
+                if (!failure) {
+                    failure = exception;
+                    stop();
+                }
+            };
+            auto guarded = [&](size_t worker) {
+                try {
+                    body(worker);
+                } catch (...) {
+                    fail(std::current_exception());
+                }
+            };
+
+            std::vector<std::thread> pool;
+            try {
+                for (size_t worker = 1; worker < workers; ++worker) {
+                    pool.emplace_back(guarded, worker);
+                }
+            } catch (...) {
+                fail(std::current_exception()); // no more threads to be had
+            }
+            if (workers != 0) {
+                guarded(0);
+            }
+            for (auto& thread : pool) {
+                thread.join();
+            }
+            if (failure) {
+                std::rethrow_exception(failure);
+            }
+        }
+
+        // runs work(begin, end) over consecutive chunks of [0, size) on up to `threads` threads, the
+        // calling one included; chunks are handed out in order, and a worker stops at the first
+        // chunk for which work returns false
+        template<typename Work>
+        void forEachChunk(size_t size, size_t threads, Work& work) {
+            const size_t minChunk = 1024;
+            const size_t workers = std::min(workerCount(threads), std::max<size_t>(size / minChunk, 1));
+            const size_t chunk = std::min<size_t>(std::max(size / (workers * 16), minChunk), size_t(1) << 16);
+            std::atomic<size_t> next { 0 };
+            auto run = [&](size_t) {
+                const uint64_t id = trace::nextId();
+                for (;;) {
+                    const size_t begin = next.fetch_add(chunk, std::memory_order_relaxed);
+                    if (begin >= size) {
+                        return;
+                    }
+                    trace::record("chunk", 'b', id);
+                    const bool more = work(begin, std::min(size - begin, chunk) + begin);
+                    trace::record("chunk", 'e', id);
+                    if (!more) {
+                        return;
+                    }
+                }
+            };
+            runWorkers(workers, run, [&next, size] { next.store(size); });
+        }
+
+        // runs work(block) for every block in [0, blocks), one thread per block; the first
+        // exception thrown is rethrown once every block is done
+        template<typename Work>
+        void forEachBlock(size_t blocks, Work& work) {
+            runWorkers(blocks, work, [] {});
+        }
+
+        // two-pass block scan: every worker reduces its block, the block totals are scanned into
+        // offsets, then every worker scans its block again from its offset; op must be associative
+        // and also combine two accumulators
+        template<typename Accumulator, typename Extractor, typename Operation>
+        std::vector<Accumulator> parallelScan(const Extractor& extractor, Accumulator init, Operation& op, size_t threads, bool inclusive) {
+            const size_t size = Extractor(extractor).remaining();
+            assert(size != std::numeric_limits<size_t>::max() && "endless streams cannot be scanned eagerly");
+            std::vector<Accumulator> output(size);
+            // std::vector<bool> packs neighbouring results into one word, so blocks could not write
+            // theirs concurrently: bool scans run as a single block
+            const size_t blocks = std::is_same<Accumulator, bool>::value ? 1 : std::min(workerCount(threads), std::max<size_t>(size / 4096, 1));
+            const size_t blockSize = (size + blocks - 1) / blocks;
+            auto bounds = [&](size_t block) {
+                return std::make_pair(std::min(size, block * blockSize), std::min(size, (block + 1) * blockSize));
+            };
+
+            std::vector<Optional<Accumulator>> totals(blocks);
+            auto reduce = [&](size_t block) {
+                const auto range = bounds(block);
+                if (block + 1 == blocks || range.first == range.second) {
+                    return; // nothing follows the last block
+                }
+                Extractor local = extractor;
+                local.jump(range.first);
+                local.advance();
+                Accumulator total = *local.get();
+                for (size_t i = range.first + 1; i != range.second; ++i) {
+                    local.advance();
+                    total = op(total, *local.get());
+                }
+                totals[block] = std::move(total);
+            };
+            forEachBlock(blocks, reduce);
+
+            std::vector<Accumulator> offsets(blocks, init);
+            for (size_t block = 1; block < blocks; ++block) {
+                offsets[block] = totals[block - 1] ? op(offsets[block - 1], *totals[block - 1]) : offsets[block - 1];
+            }
+
+            auto rescan = [&](size_t block) {
+                const auto range = bounds(block);
+                Extractor local = extractor;
+                local.jump(range.first);
+                Accumulator accumulator = offsets[block];
+                for (size_t i = range.first; i != range.second; ++i) {
+                    local.advance();
+                    if (!inclusive) {
+                        output[i] = accumulator;
+                    }
+                    accumulator = op(accumulator, *local.get());
+                    if (inclusive) {
+                        output[i] = accumulator;
+                    }
+                }
+            };
+            forEachBlock(blocks, rescan);
+            return output;
+        }
+
+        // index of the first element (or, unordered, of any element) matching the predicate,
+        // SIZE_MAX if none does; workers publish hits through one atomic and give up on ranges
+        // that cannot beat it
+        template<typename Extractor, typename Predicate>
+        size_t parallelSearch(const Extractor& extractor, Predicate& predicate, size_t threads, bool first) {
+            constexpr size_t none = std::numeric_limits<size_t>::max();
+            std::atomic<size_t> best { none };
+            auto work = [&](size_t begin, size_t end) {
+                if (first ? begin > best.load(std::memory_order_relaxed) : best.load(std::memory_order_relaxed) != none) {
+                    return false;
+                }
+                Extractor local = extractor;
+                local.jump(begin);
+                for (size_t i = begin; i != end; ++i) {
+                    if ((i & 1023) == 0 && (first ? i > best.load(std::memory_order_relaxed) : best.load(std::memory_order_relaxed) != none)) {
+                        return false;
+                    }
+                    bool found;
+                    try {
+                        local.advance();
+                        found = predicate(*local.get());
+                    } catch (...) {
+                        best.store(0); // every other worker gives up at its next check
+                        throw;
+                    }
+                    if (found) {
+                        size_t current = best.load(std::memory_order_relaxed);
+                        while (i < current && !best.compare_exchange_weak(current, i, std::memory_order_relaxed)) {}
+                        return false; // whatever follows in this worker comes later
+                    }
+                }
+                return true;
+            };
+            forEachChunk(Extractor(extractor).remaining(), threads, work);
+            return best.load();
+        }
+    }
+
+    namespace detail {
+        // keys mapped to unsigned integers of the same order: the sign bit flipped for signed
+        // integers, all bits of negative and the sign bit of positive IEEE floats (-0.0 taken as
+        // 0.0, which std::less holds equal)
+        template<typename Key, typename = std::enable_if_t<std::is_integral<Key>::value>>
+        auto radixKey(Key key) {
+            using Unsigned = std::make_unsigned_t<std::conditional_t<std::is_same<Key, bool>::value, unsigned char, Key>>;
+            const Unsigned bits = static_cast<Unsigned>(key);
+            return std::is_signed<Key>::value ? static_cast<Unsigned>(bits ^ (Unsigned(1) << (sizeof(Unsigned) * 8 - 1))) : bits;
+        }
+
+        template<typename Key>
+        std::enable_if_t<std::is_floating_point<Key>::value && sizeof(Key) == 8, uint64_t> radixKey(Key key) {
+            uint64_t bits;
+            key = key == 0 ? Key(0) : key;
+            std::memcpy(&bits, &key, sizeof(bits));
+            return bits ^ ((bits >> 63) != 0 ? ~uint64_t(0) : uint64_t(1) << 63);
+        }
+
+        template<typename Key>
+        std::enable_if_t<std::is_floating_point<Key>::value && sizeof(Key) == 4, uint32_t> radixKey(Key key) {
+            uint32_t bits;
+            key = key == 0 ? Key(0) : key;
+            std::memcpy(&bits, &key, sizeof(bits));
+            return bits ^ ((bits >> 31) != 0 ? ~uint32_t(0) : uint32_t(1) << 31);
+        }
+
+        // the types radixKey is defined for; long double and the like go to the merge sort
+        template<typename Key>
+        struct HasRadixKey : std::integral_constant<bool, std::is_integral<Key>::value ||
+                                                          (std::is_floating_point<Key>::value && std::numeric_limits<Key>::is_iec559 && (sizeof(Key) == 4 || sizeof(Key) == 8))> {};
+
+        template<typename Unsigned>
+        struct RadixItem {
+            Unsigned key;
+            size_t index;
+        };
+
+        // stable LSD radix sort on bytes; each pass counts per block in parallel, turns the counts
+        // into per-block offsets and scatters per block in parallel. Passes over a byte that all
+        // keys share are skipped.
+        template<typename Unsigned>
+        void radixSort(std::vector<RadixItem<Unsigned>>& items, size_t threads) {
+            const size_t size = items.size();
+            const size_t blocks = std::min(workerCount(threads), std::max<size_t>(size / 65536, 1));
+            const size_t blockSize = (size + blocks - 1) / blocks;
+            std::vector<RadixItem<Unsigned>> buffer(size);
+            std::vector<std::array<size_t, 256>> counts(blocks);
+            for (unsigned shift = 0; shift != sizeof(Unsigned) * 8; shift += 8) {
+                auto count = [&](size_t block) {
+                    counts[block].fill(0);
+                    for (size_t i = block * blockSize, end = std::min(size, i + blockSize); i < end; ++i) {
+                        ++counts[block][(items[i].key >> shift) & 0xff];
+                    }
+                };
+                forEachBlock(blocks, count);
+
+                size_t offset = 0;
+                bool shared = false;
+                for (size_t digit = 0; digit != 256; ++digit) {
+                    size_t total = 0;
+                    for (size_t block = 0; block != blocks; ++block) {
+                        const size_t n = counts[block][digit];
+                        counts[block][digit] = offset;
+                        offset += n;
+                        total += n;
+                    }
+                    shared |= total == size;
+                }
+                if (shared) {
+                    continue;
+                }
+
+                auto scatter = [&](size_t block) {
+                    auto& offsets = counts[block];
+                    for (size_t i = block * blockSize, end = std::min(size, i + blockSize); i < end; ++i) {
+                        buffer[offsets[(items[i].key >> shift) & 0xff]++] = items[i];
+                    }
+                };
+                forEachBlock(blocks, scatter);
+                items.swap(buffer);
+            }
+        }
+
+        template<typename T, typename KeyFn>
+        void radixSortBy(std::vector<T>& elements, KeyFn& keyOf, size_t threads) {
+            using Unsigned = decltype(radixKey(keyOf(elements.front())));
+            std::vector<RadixItem<Unsigned>> items(elements.size());
+            for (size_t i = 0; i != elements.size(); ++i) {
+                items[i] = { radixKey(keyOf(elements[i])), i };
+            }
+            radixSort(items, threads);
+            std::vector<T> sorted;
+            sorted.reserve(elements.size());
+            for (auto& item : items) {
+                sorted.push_back(std::move(elements[item.index]));
+            }
+            elements.swap(sorted);
+        }
+
+        // stable: blocks are sorted in parallel, then merged pairwise in parallel rounds
+        template<typename T, typename Comparator>
+        void mergeSort(std::vector<T>& elements, Comparator& cmp, size_t threads) {
+            const size_t size = elements.size();
+            const size_t blocks = std::min(workerCount(threads), std::max<size_t>(size / 8192, 1));
+            const size_t blockSize = (size + blocks - 1) / blocks;
+            auto at = [&](size_t i) {
+                return elements.begin() + static_cast<std::ptrdiff_t>(std::min(size, i));
+            };
+            auto sortBlock = [&](size_t block) {
+                std::stable_sort(at(block * blockSize), at((block + 1) * blockSize), cmp);
+            };
+            forEachBlock(blocks, sortBlock);
+            for (size_t width = blockSize; width < size; width *= 2) {
+                auto merge = [&](size_t pair) {
+                    const size_t begin = pair * 2 * width;
+                    std::inplace_merge(at(begin), at(begin + width), at(begin + 2 * width), cmp);
+                };
+                forEachBlock((size + 2 * width - 1) / (2 * width), merge);
+            }
+        }
+
+        template<typename T, typename Comparator>
+        struct IsNaturalOrder : std::integral_constant<bool, HasRadixKey<T>::value &&
+                                                             (std::is_same<Comparator, std::less<>>::value || std::is_same<Comparator, std::less<T>>::value)> {};
+
+        template<typename T, typename Comparator>
+        void sortElements(std::vector<T>& elements, Comparator&, size_t threads, std::true_type /* natural order */) {
+            auto identity = [](const T& e) { return e; };
+            if (!elements.empty()) {
+                radixSortBy(elements, identity, threads);
+            }
+        }
+
+        template<typename T, typename Comparator>
+        void sortElements(std::vector<T>& elements, Comparator& cmp, size_t threads, std::false_type) {
+            mergeSort(elements, cmp, threads);
+        }
+
+        template<typename T, typename KeyFn>
+        void sortElementsBy(std::vector<T>& elements, KeyFn& keyOf, size_t threads, std::true_type /* radix key */) {
+            if (!elements.empty()) {
+                radixSortBy(elements, keyOf, threads);
+            }
+        }
+
+        template<typename T, typename KeyFn>
+        void sortElementsBy(std::vector<T>& elements, KeyFn& keyOf, size_t threads, std::false_type) {
+            auto byKey = [&keyOf](const T& lhs, const T& rhs) { return keyOf(lhs) < keyOf(rhs); };
+            mergeSort(elements, byKey, threads);
+        }
+
+        template<typename Extractor>
+        std::enable_if_t<traits::IsRandomAccess<Extractor>::value, size_t> sizeHint(Extractor& extractor) {
+            const size_t remaining = extractor.remaining();
+            return remaining != std::numeric_limits<size_t>::max() ? remaining : 0;
+        }
+
+        template<typename Extractor>
+        std::enable_if_t<!traits::IsRandomAccess<Extractor>::value, size_t> sizeHint(Extractor&) {
+            return 0;
+        }
+    }
+
+    // sorted()/sortedBy(): pulls the whole source on first use, sorts it with Sorter and hands the
+    // elements out in order; random-access from then on. Copies share the sorted buffer, which
+    // is read-only once built, so copying the extractor (as random-access iterators and the
+    // parallel terminals do) costs O(1).
+    template<typename ExtractorType, typename Sorter>
+    struct EMPTY_BASES SortedStreamExtractor : StreamExtractor<SortedStreamExtractor<ExtractorType, Sorter>>, detail::FunctorStorage<Sorter> {
+        using Element = traits::ValueType<ExtractorType>;
+
+        struct Shared {
+            explicit Shared(ExtractorType source) : source(std::move(source)) {}
+
+            ExtractorType source;
+            std::vector<Element> elements;
+            std::once_flag sorted;
+        };
+
+        SortedStreamExtractor(ExtractorType extractor, Sorter&& sorter)
+            : detail::FunctorStorage<Sorter>(std::forward<Sorter>(sorter)), shared(std::make_shared<Shared>(std::move(extractor))) {}
+
+        std::shared_ptr<Shared> shared;
+        size_t next = 0;
+
+        const Element* get_impl() {
+            return &shared->elements[next - 1];
+        }
+
+        bool advance_impl() {
+            materialize();
+            if (next == shared->elements.size()) {
+                return false;
+            }
+            ++next;
+            return true;
+        }
+
+        size_t remaining_impl() {
+            materialize();
+            return shared->elements.size() - next;
+        }
+
+        void jump_impl(size_t n) {
+            next += n;
+        }
+
+        void materialize() {
+            std::call_once(shared->sorted, [this] {
+                auto& elements = shared->elements;
+                elements.reserve(detail::sizeHint(shared->source));
+                while (shared->source.advance()) {
+                    elements.push_back(*shared->source.get());
+                }
+                this->functor()(elements);
+            });
+        }
+    };
+
+    // how much a bounded terminal (foldFor, forEachFor) may do in one call: it stops after
+    // `elements` elements or once `time` has passed. The clock is read once per `batch` elements,
+    // and the first batch always runs so that every call makes progress.
+    struct Budget {
+        using Clock = std::chrono::steady_clock;
+
+        Clock::duration time = Clock::duration::max();
+        size_t elements = std::numeric_limits<size_t>::max();
+        size_t batch = 64;
+    };
+
+    // where a bounded terminal stopped; the stream is left before the next unprocessed element
+    struct Progress {
+        size_t processed;
+        bool finished; // the stream ran out
+    };
+
+    template<typename T>
+    struct Partial {
+        T value;
+        size_t processed;
+        bool finished;
+    };
+
+    namespace detail {
+        template<typename Extractor, typename Step>
+        Progress runFor(Extractor& extractor, const Budget& budget, Step&& step) {
+            const bool timed = budget.time != Budget::Clock::duration::max();
+            const auto start = timed ? Budget::Clock::now() : Budget::Clock::time_point();
+            const size_t batch = std::max<size_t>(budget.batch, 1);
+            Progress progress{ 0, false };
+            for (size_t untilCheck = batch; progress.processed != budget.elements; --untilCheck) {
+                if (untilCheck == 0) {
+                    if (timed && Budget::Clock::now() - start >= budget.time) {
+                        break;
+                    }
+                    untilCheck = batch;
+                }
+                if (!extractor.advance()) {
+                    progress.finished = true;
+                    break;
+                }
+                step(*extractor.get());
+                ++progress.processed;
+            }
+            return progress;
+        }
+    }
+
+    // begin() of a stream: an input iterator that pulls the stream as it is incremented; the end
+    // iterator is a default-constructed one. A ValuePointer is kept so that the element outlives
+    // the call to get() that computed it.
+    template<typename Stream>
+    struct StreamIterator {
+        using Pointer = decltype(std::declval<Stream&>().extractor.get());
+        using iterator_category = std::input_iterator_tag;
+        using value_type = std::remove_const_t<typename Stream::value_type>;
+        using difference_type = std::ptrdiff_t;
+        using reference = decltype(**std::declval<const Optional<Pointer>&>());
+        using pointer = std::add_pointer_t<reference>;
+
+        StreamIterator() = default;
+        explicit StreamIterator(Stream* stream) : stream(stream) { ++*this; }
+
+        Stream* stream = nullptr;
+        Optional<Pointer> current;
+
+        reference operator * () const { return **current; }
+        pointer operator -> () const { return &**current; }
+
+        StreamIterator& operator ++ () {
+            if (stream->extractor.advance()) {
+                current = stream->extractor.get();
+            }
+            else {
+                stream = nullptr;
+                current = nullopt;
+            }
+            return *this;
+        }
+
+        // holds a copy of the element it++ moved past, so that *it++ reads it (as istreambuf_iterator)
+        struct Postfix {
+            value_type value;
+            const value_type& operator * () const { return value; }
+        };
+
+        Postfix operator ++ (int) {
+            Postfix previous { **current };
+            ++*this;
+            return previous;
+        }
+
+        friend bool operator == (const StreamIterator& lhs, const StreamIterator& rhs) { return lhs.stream == rhs.stream; }
+        friend bool operator != (const StreamIterator& lhs, const StreamIterator& rhs) { return lhs.stream != rhs.stream; }
+    };
+
+    // random-access iterator over a random-access stream, for the standard algorithms that split
+    // their input (the std::execution ones among them). Each dereference jumps a copy of the
+    // extractor, so it returns the element by value and does not disturb other iterators; the
+    // random-access stages keep that copy O(1) (sorted() shares its buffer between copies).
+    template<typename ExtractorType>
+    struct RandomAccessStreamIterator {
+        using iterator_category = std::random_access_iterator_tag;
+        using value_type = traits::ValueType<ExtractorType>;
+        using difference_type = std::ptrdiff_t;
+        using reference = value_type;
+        using pointer = void;
+
+        const ExtractorType* origin = nullptr;
+        difference_type index = 0;
+
+        value_type operator * () const {
+            ExtractorType extractor(*origin);
+            extractor.jump(static_cast<size_t>(index));
+            extractor.advance();
+            return *extractor.get();
+        }
+
+        value_type operator [] (difference_type n) const { return *(*this + n); }
+
+        RandomAccessStreamIterator& operator ++ () { ++index; return *this; }
+        RandomAccessStreamIterator& operator -- () { --index; return *this; }
+        RandomAccessStreamIterator operator ++ (int) { auto copy = *this; ++index; return copy; }
+        RandomAccessStreamIterator operator -- (int) { auto copy = *this; --index; return copy; }
+        RandomAccessStreamIterator& operator += (difference_type n) { index += n; return *this; }
+        RandomAccessStreamIterator& operator -= (difference_type n) { index -= n; return *this; }
+
+        friend RandomAccessStreamIterator operator + (RandomAccessStreamIterator it, difference_type n) { return it += n; }
+        friend RandomAccessStreamIterator operator + (difference_type n, RandomAccessStreamIterator it) { return it += n; }
+        friend RandomAccessStreamIterator operator - (RandomAccessStreamIterator it, difference_type n) { return it -= n; }
+        friend difference_type operator - (const RandomAccessStreamIterator& lhs, const RandomAccessStreamIterator& rhs) { return lhs.index - rhs.index; }
+
+        friend bool operator == (const RandomAccessStreamIterator& lhs, const RandomAccessStreamIterator& rhs) { return lhs.index == rhs.index; }
+        friend bool operator != (const RandomAccessStreamIterator& lhs, const RandomAccessStreamIterator& rhs) { return lhs.index != rhs.index; }
+        friend bool operator < (const RandomAccessStreamIterator& lhs, const RandomAccessStreamIterator& rhs) { return lhs.index < rhs.index; }
+        friend bool operator > (const RandomAccessStreamIterator& lhs, const RandomAccessStreamIterator& rhs) { return lhs.index > rhs.index; }
+        friend bool operator <= (const RandomAccessStreamIterator& lhs, const RandomAccessStreamIterator& rhs) { return lhs.index <= rhs.index; }
+        friend bool operator >= (const RandomAccessStreamIterator& lhs, const RandomAccessStreamIterator& rhs) { return lhs.index >= rhs.index; }
+    };
+
+    // what randomAccess() returns: owns the extractor the iterators jump from
+    template<typename ExtractorType>
+    struct RandomAccessStreamRange {
+        ExtractorType extractor;
+        size_t length;
+
+        RandomAccessStreamIterator<ExtractorType> begin() const { return { &extractor, 0 }; }
+        RandomAccessStreamIterator<ExtractorType> end() const { return { &extractor, static_cast<std::ptrdiff_t>(length) }; }
+        size_t size() const { return length; }
+        bool empty() const { return length == 0; }
+    };
+
+#if defined __cpp_lib_ranges
+    // view() of a stream: a move-only std::ranges::view, so it composes with the std::views
+    // adaptors and std::ranges algorithms
+    template<typename Stream>
+    struct StreamView : std::ranges::view_interface<StreamView<Stream>> {
+        explicit StreamView(Stream stream) : stream(std::move(stream)) {}
+        StreamView(StreamView&&) = default;
+        StreamView& operator = (StreamView&&) = default;
+
+        Stream stream;
+
+        StreamIterator<Stream> begin() { return StreamIterator<Stream>(&stream); }
+        StreamIterator<Stream> end() { return {}; }
+    };
+#endif
+
+    template<typename ExtractorType>
+    struct BaseStreamInterface {
+        ExtractorType extractor;
+        using value_type = std::remove_reference_t<decltype(*extractor.get())>;
+
+        CONSTEXPR BaseStreamInterface(ExtractorType e) : extractor(std::move(e)) {}
+
+        // Intermediate Operations
+        //
+        // The && overloads move the upstream extractors into the new stage, so a chain written in
+        // one expression copies neither them nor the functors it is given and may hold move-only
+        // ones. The const& overloads copy this stream first and leave it usable.
+
+        template<typename Transform>
+        auto map(Transform&& transform) && {
+            using Extractor = MapStreamExtractor<decltype(extractor), Transform>;
+            return BaseStreamInterface<Extractor>(Extractor(std::move(extractor), std::forward<Transform>(transform)));
+        }
+
+        template<typename Transform>
+        auto map(Transform&& transform) const& {
+            return BaseStreamInterface(*this).map(std::forward<Transform>(transform));
+        }
+
+        // expects that std::begin and std::end can be called on the result of transform
+        template<typename Transform>
+        auto flatMap(Transform&& transform) && {
+            using Extractor = FlatMapStreamExtractor<decltype(extractor), Transform>;
+            return BaseStreamInterface<Extractor>(Extractor(std::move(extractor), std::forward<Transform>(transform)));
+        }
+
+        template<typename Transform>
+        auto flatMap(Transform&& transform) const& {
+            return BaseStreamInterface(*this).flatMap(std::forward<Transform>(transform));
+        }
+
+        // add flatten level
+        auto flatten() && {
+            auto flat = [](auto&& e) { return e; };
+            using Extractor = FlatMapStreamExtractor<decltype(extractor), decltype(flat)>;
+            return BaseStreamInterface<Extractor>(Extractor(std::move(extractor), std::move(flat)));
+        }
+
+        auto flatten() const& {
+            return BaseStreamInterface(*this).flatten();
+        }
+
+        template<typename Predicate>
+        auto filter(Predicate&& predicate) && {
+            using Extractor = FilterStreamExtractor<decltype(extractor), Predicate>;
+            return BaseStreamInterface<Extractor>(Extractor(std::move(extractor), std::forward<Predicate>(predicate)));
+        }
+
+        template<typename Predicate>
+        auto filter(Predicate&& predicate) const& {
+            return BaseStreamInterface(*this).filter(std::forward<Predicate>(predicate));
+        }
+
+        template<typename Transform>
+        auto filterMap(Transform&& transform) && {
+            using Extractor = FilterMapStreamExtractor<decltype(extractor), Transform>;
+            return BaseStreamInterface<Extractor>(Extractor(std::move(extractor), std::forward<Transform>(transform)));
+        }
+
+        template<typename Transform>
+        auto filterMap(Transform&& transform) const& {
+            return BaseStreamInterface(*this).filterMap(std::forward<Transform>(transform));
+        }
+
+        auto skip(size_t count) && {
+            using Extractor = SkipFirstStreamExtractor<decltype(extractor)>;
+            return BaseStreamInterface<Extractor>(Extractor(std::move(extractor), count));
+        }
+
+        auto skip(size_t count) const& {
+            return BaseStreamInterface(*this).skip(count);
+        }
+
+        template<typename Predicate>
+        auto skipWhile(Predicate&& predicate) && {
+            using Extractor = SkipWhileStreamExtractor<decltype(extractor), Predicate>;
+            return BaseStreamInterface<Extractor>(Extractor(std::move(extractor), std::forward<Predicate>(predicate)));
+        }
+
+        template<typename Predicate>
+        auto skipWhile(Predicate&& predicate) const& {
+            return BaseStreamInterface(*this).skipWhile(std::forward<Predicate>(predicate));
+        }
+
+        auto take(size_t count) && {
+            using Extractor = TakeStreamExtractor<decltype(extractor)>;
+            return BaseStreamInterface<Extractor>(Extractor(std::move(extractor), count));
+        }
+
+        auto take(size_t count) const& {
+            return BaseStreamInterface(*this).take(count);
+        }
+
+        template<size_t N>
+        auto take() && {
+            using Extractor = TakeFixedStreamExtractor<decltype(extractor), N>;
+            return BaseStreamInterface<Extractor>(Extractor(std::move(extractor)));
+        }
+
+        template<size_t N>
+        auto take() const& {
+            return BaseStreamInterface(*this).template take<N>();
+        }
+
+        template<typename Predicate>
+        auto takeWhile(Predicate&& predicate) && {
+            using Extractor = TakeWhileStreamExtractor<decltype(extractor), Predicate>;
+            return BaseStreamInterface<Extractor>(Extractor(std::move(extractor), std::forward<Predicate>(predicate)));
+        }
+
+        template<typename Predicate>
+        auto takeWhile(Predicate&& predicate) const& {
+            return BaseStreamInterface(*this).takeWhile(std::forward<Predicate>(predicate));
+        }
+
+        template<typename Inspector>
+        auto inspect(Inspector&& inspector) && {
+            using Extractor = InspectStreamExtractor<decltype(extractor), Inspector>;
+            return BaseStreamInterface<Extractor>(Extractor(std::move(extractor), std::forward<Inspector>(inspector)));
+        }
+
+        template<typename Inspector>
+        auto inspect(Inspector&& inspector) const& {
+            return BaseStreamInterface(*this).inspect(std::forward<Inspector>(inspector));
+        }
+
+        template<typename Inspector>
+        auto spy(Inspector&& inspector) && {
+            using Extractor = SpyStreamExtractor<decltype(extractor), Inspector>;
+            return BaseStreamInterface<Extractor>(Extractor(std::move(extractor), std::forward<Inspector>(inspector)));
+        }
+
+        template<typename Inspector>
+        auto spy(Inspector&& inspector) const& {
+            return BaseStreamInterface(*this).spy(std::forward<Inspector>(inspector));
+        }
+
+        // Bernoulli sampling with probability p; the cost follows the output size, not the input
+        auto sampleBernoulli(double p, uint64_t seed = 0) && {
+            using Extractor = SampleStreamExtractor<decltype(extractor)>;
+            return BaseStreamInterface<Extractor>(Extractor(std::move(extractor), p, seed));
+        }
+
+        auto sampleBernoulli(double p, uint64_t seed = 0) const& {
+            return BaseStreamInterface(*this).sampleBernoulli(p, seed);
+        }
+
+        auto enumerate(size_t from = 0) && {
+            using Extractor = EnumerateStreamExtractor<decltype(extractor)>;
+            return BaseStreamInterface<Extractor>(Extractor(std::move(extractor), from));
+        }
+
+        auto enumerate(size_t from = 0) const& {
+            return BaseStreamInterface(*this).enumerate(from);
+        }
+
+        auto enumerateTup(size_t from = 0) && {
+            using Extractor = EnumerateTupleStreamExtractor<decltype(extractor)>;
+            return BaseStreamInterface<Extractor>(Extractor(std::move(extractor), from));
+        }
+
+        auto enumerateTup(size_t from = 0) const& {
+            return BaseStreamInterface(*this).enumerateTup(from);
+        }
+
+        template <template<typename> class StreamOther, typename OtherExtractor>
+        auto chain(StreamOther<OtherExtractor> other) && {
+            using Extractor = ChainStreamExtractor<decltype(extractor), OtherExtractor>;
+            return BaseStreamInterface<Extractor>(Extractor(std::move(extractor), std::move(other.extractor)));
+        }
+
+        template <template<typename> class StreamOther, typename OtherExtractor>
+        auto chain(StreamOther<OtherExtractor> other) const& {
+            return BaseStreamInterface(*this).chain(std::move(other));
+        }
+
+        template <template<typename> class StreamOther, typename OtherExtractor>
+        auto zip(StreamOther<OtherExtractor> other) && {
+            using Extractor = ZipStreamExtractor<decltype(extractor), OtherExtractor>;
+            return BaseStreamInterface<Extractor>(Extractor(std::move(extractor), std::move(other.extractor)));
+        }
+
+        template <template<typename> class StreamOther, typename OtherExtractor>
+        auto zip(StreamOther<OtherExtractor> other) const& {
+            return BaseStreamInterface(*this).zip(std::move(other));
+        }
+
+        // windows of `size` starting every `slide` (tumbling when both are equal) on event time,
+        // each aggregated incrementally by an aggregator from namespace aggregators
+        template<typename TimestampFn, typename Duration, typename AggregatorSpec = aggregators::Count>
+        auto windowByTime(TimestampFn&& ts, Duration size, Duration slide, AggregatorSpec spec = {}) && {
+            using Timestamp = std::decay_t<traits::ApplyOnValueType<decltype(extractor), TimestampFn>>;
+            using Aggregator = decltype(spec.template bind<traits::ValueType<decltype(extractor)>>());
+            using Extractor = WindowByTimeStreamExtractor<decltype(extractor), TimestampFn, Aggregator, Timestamp>;
+            assert(static_cast<Timestamp>(slide) > Timestamp(0) && "windows must move forward");
+            return BaseStreamInterface<Extractor>(Extractor(std::move(extractor), std::forward<TimestampFn>(ts), static_cast<Timestamp>(size), static_cast<Timestamp>(slide),
+                                                            spec.template bind<traits::ValueType<decltype(extractor)>>()));
+        }
+
+        template<typename TimestampFn, typename Duration, typename AggregatorSpec = aggregators::Count>
+        auto windowByTime(TimestampFn&& ts, Duration size, Duration slide, AggregatorSpec spec = {}) const& {
+            return BaseStreamInterface(*this).windowByTime(std::forward<TimestampFn>(ts), size, slide, std::move(spec));
+        }
+
+        // only for streams created by fromColumns
+        template<size_t... Columns>
+        auto project() const {
+            using Extractor = decltype(extractor.template project<Columns...>());
+            return BaseStreamInterface<Extractor>(extractor.template project<Columns...>());
+        }
+
+        // running aggregate; op(accumulator, element) returns the new accumulator
+        template<typename Accumulator, typename Operation>
+        auto scan(Accumulator init, Operation&& op) && {
+            using Extractor = ScanStreamExtractor<decltype(extractor), Accumulator, Operation>;
+            return BaseStreamInterface<Extractor>(Extractor(std::move(extractor), std::move(init), std::forward<Operation>(op)));
+        }
+
+        template<typename Accumulator, typename Operation>
+        auto scan(Accumulator init, Operation&& op) const& {
+            return BaseStreamInterface(*this).scan(std::move(init), std::forward<Operation>(op));
+        }
+
+        template<typename Accumulator, typename Operation>
+        auto scanExclusive(Accumulator init, Operation&& op) && {
+            using Extractor = ScanExclusiveStreamExtractor<decltype(extractor), Accumulator, Operation>;
+            return BaseStreamInterface<Extractor>(Extractor(std::move(extractor), std::move(init), std::forward<Operation>(op)));
+        }
+
+        template<typename Accumulator, typename Operation>
+        auto scanExclusive(Accumulator init, Operation&& op) const& {
+            return BaseStreamInterface(*this).scanExclusive(std::move(init), std::forward<Operation>(op));
+        }
+
+        // A stable sort of the whole stream, done when the first element is asked for. The natural
+        // order of integers, floats and doubles uses a parallel LSD radix sort, other orders a
+        // parallel merge sort; `threads` (hardware_concurrency() when 0) bounds the parallelism.
+        // An exception thrown by the comparator (or keyOf) is rethrown once all threads are done.
+        template<typename Comparator = std::less<>>
+        auto sorted(Comparator cmp = {}, size_t threads = 0) && {
+            using Element = traits::ValueType<decltype(extractor)>;
+            auto sorter = [cmp, threads](std::vector<Element>& elements) mutable {
+                detail::sortElements(elements, cmp, threads, detail::IsNaturalOrder<Element, Comparator>{});
+            };
+            using Extractor = SortedStreamExtractor<decltype(extractor), decltype(sorter)>;
+            return BaseStreamInterface<Extractor>(Extractor(std::move(extractor), std::move(sorter)));
+        }
+
+        template<typename Comparator = std::less<>>
+        auto sorted(Comparator cmp = {}, size_t threads = 0) const& {
+            return BaseStreamInterface(*this).sorted(std::move(cmp), threads);
+        }
+
+        // ascending by keyOf(e), computed once per element for integer, float and double keys
+        template<typename KeyFn>
+        auto sortedBy(KeyFn keyOf, size_t threads = 0) && {
+            using Element = traits::ValueType<decltype(extractor)>;
+            using Key = std::decay_t<decltype(keyOf(std::declval<const Element&>()))>;
+            auto sorter = [keyOf = std::move(keyOf), threads](std::vector<Element>& elements) mutable {
+                detail::sortElementsBy(elements, keyOf, threads, detail::HasRadixKey<Key>{});
+            };
+            using Extractor = SortedStreamExtractor<decltype(extractor), decltype(sorter)>;
+            return BaseStreamInterface<Extractor>(Extractor(std::move(extractor), std::move(sorter)));
+        }
+
+        template<typename KeyFn>
+        auto sortedBy(KeyFn keyOf, size_t threads = 0) const& {
+            return BaseStreamInterface(*this).sortedBy(std::move(keyOf), threads);
+        }
+
+        // names this point of the chain on a trace timeline (see namespace trace); the name must
+        // outlive the export, label() without one uses the extractor type
+        auto label(const char* name, size_t batch = 1024) && {
+            using Extractor = LabelStreamExtractor<decltype(extractor)>;
+            return BaseStreamInterface<Extractor>(Extractor(std::move(extractor), name, batch));
+        }
+
+        auto label(const char* name, size_t batch = 1024) const& {
+            return BaseStreamInterface(*this).label(name, batch);
+        }
+
+        auto label() && {
+            return std::move(*this).label(detail::templateName<ExtractorType>());
+        }
+
+        auto label() const& {
+            return BaseStreamInterface(*this).label();
+        }
+
+        auto purify() && {
+            static_assert(traits::IsOptional<value_type>(), "Purify should be called on a stream of Optional<T> values");
+            using Extractor = PurifyStreamExtractor<decltype(extractor)>;
+            return BaseStreamInterface<Extractor>(Extractor(std::move(extractor)));
+        }
+
+        auto purify() const& {
+            return BaseStreamInterface(*this).purify();
+        }
+
+        // Non-Terminal
+
+        Optional<value_type> next() {
+            if (extractor.advance()) {
+                return{ *extractor.get() };
+            }
+            return{};
+        }
+
+        Optional<value_type> nth(size_t n) {
+            if (!detail::skipElements(extractor, n)) {
+                return nullopt;
+            }
+            return next();
+        }
+
+        // Iteration
+        //
+        // begin() and end() pull this stream as they are incremented: a range-for loop or an
+        // algorithm over input iterators consumes it, once.
+
+        StreamIterator<BaseStreamInterface> begin() {
+            return StreamIterator<BaseStreamInterface>(this);
+        }
+
+        StreamIterator<BaseStreamInterface> end() {
+            return {};
+        }
+
+        // the remaining elements as a sized range with random-access iterators
+        template<typename E = ExtractorType, typename = std::enable_if_t<traits::IsRandomAccess<E>::value>>
+        RandomAccessStreamRange<ExtractorType> randomAccess() && {
+            const size_t length = extractor.remaining();
+            assert(length != std::numeric_limits<size_t>::max() && "an endless stream has no end iterator");
+            return { std::move(extractor), length };
+        }
+
+        template<typename E = ExtractorType, typename = std::enable_if_t<traits::IsRandomAccess<E>::value>>
+        RandomAccessStreamRange<ExtractorType> randomAccess() const& {
+            return BaseStreamInterface(*this).randomAccess();
+        }
+
+#if defined __cpp_lib_ranges
+        StreamView<BaseStreamInterface> view() && {
+            return StreamView<BaseStreamInterface>(std::move(*this));
+        }
+
+        StreamView<BaseStreamInterface> view() const& {
+            return StreamView<BaseStreamInterface>(*this);
+        }
+#endif
+
+        // Terminal Operations 
+
+        Optional<value_type> last() {
+            if (!extractor.advance()) {
+                return nullopt;
+            } else {
+                auto ptr = extractor.get();
+                while (extractor.advance()) {
+                    ptr = extractor.get();
+                }				
+                return *ptr;			
+            }
+        }
+
+        template<typename Callable>
+        void forEach(Callable&& callable) {
+            while (extractor.advance()) {
+                callable(*extractor.get());
+            }
+        }
+
+        // forEach within a budget; call again to go on from where it stopped
+        template<typename Callable>
+        Progress forEachFor(const Budget& budget, Callable&& callable) {
+            return detail::runFor(extractor, budget, callable);
+        }
+
+        size_t count() {
+            size_t counter = 0;
+            while (extractor.advance()) {
+                ++counter;
+            }
+            return counter;
+        }
+
+        template<typename Predicate>
+        bool any(Predicate&& predicate) {
+            while (extractor.advance()) {
+                if (predicate(*extractor.get())) {
+                    return true;
+                }
+            }
+            return false;
+        }
+
+        template<typename Predicate>
+        bool all(Predicate&& predicate) {
+            while (extractor.advance()) {
+                if (!predicate(*extractor.get())) {
+                    return false;
+                }
+            }
+            return true;
+        }
+
+        template<typename Comparator = std::less<std::remove_const_t<value_type>>>
+        Optional<std::remove_const_t<value_type>> min(Comparator cmp = {}) {
+            Optional<std::remove_const_t<value_type>> value {};
+            while (extractor.advance()) {
+                auto v = extractor.get();
+                if (!value || cmp(*v, *value)) { // nullopt is the least
+                    value = *v;
+                }
+            }
+            return value;
+        }
+
+        template<typename Comparator = std::greater<std::remove_const_t<value_type>>>
+        Optional<std::remove_const_t<value_type>> max(Comparator cmp = {}) {
+            return min(cmp);
+        }
+
+        template<typename Predicate>
+        Optional<std::remove_const_t<value_type>> find(Predicate&& predicate) {
+            while (extractor.advance()) {
+                auto e = extractor.get();
+                if (predicate(*e)) {
+                    return *e;
+                }
+            }
+            return nullopt;
+        }
+
+        template<typename Predicate>
+        Optional<size_t> position(Predicate&& predicate) {
+            size_t counter = 0;
+            while (extractor.advance()) {
+                ++counter;
+                if (predicate(*extractor.get())) {
+                    return counter;
+                }
+            }
+            return nullopt;
+        }
+
+        // Parallel variants for copyable random-access streams: the range is split into chunks
+        // that `threads` threads (hardware_concurrency() when 0) take in order. The predicate and
+        // the functors of the stages upstream (map, spy, ...) are called concurrently, each thread
+        // on its own copy of the chain. As their sequential counterparts, they leave the stream
+        // after the element found, or at its end; an exception thrown by any of those functors
+        // stops the search and is rethrown here once all threads are done.
+
+        template<typename Predicate, typename E = ExtractorType, typename = std::enable_if_t<traits::IsRandomAccess<E>::value>>
+        Optional<std::remove_const_t<value_type>> parallelFind(Predicate&& predicate, size_t threads = 0) {
+            return elementAt(detail::parallelSearch(extractor, predicate, threads, true));
+        }
+
+        // any matching element, not necessarily the first
+        template<typename Predicate, typename E = ExtractorType, typename = std::enable_if_t<traits::IsRandomAccess<E>::value>>
+        Optional<std::remove_const_t<value_type>> findAny(Predicate&& predicate, size_t threads = 0) {
+            return elementAt(detail::parallelSearch(extractor, predicate, threads, false));
+        }
+
+        template<typename Predicate, typename E = ExtractorType, typename = std::enable_if_t<traits::IsRandomAccess<E>::value>>
+        Optional<size_t> parallelPosition(Predicate&& predicate, size_t threads = 0) {
+            const size_t index = detail::parallelSearch(extractor, predicate, threads, true);
+            return elementAt(index) ? Optional<size_t>(index + 1) : nullopt;
+        }
+
+        template<typename Predicate, typename E = ExtractorType, typename = std::enable_if_t<traits::IsRandomAccess<E>::value>>
+        bool parallelAny(Predicate&& predicate, size_t threads = 0) {
+            return static_cast<bool>(findAny(predicate, threads));
+        }
+
+        template<typename Predicate, typename E = ExtractorType, typename = std::enable_if_t<traits::IsRandomAccess<E>::value>>
+        bool parallelAll(Predicate&& predicate, size_t threads = 0) {
+            return !findAny([&predicate](auto& e) { return !predicate(e); }, threads);
+        }
+
+        // the inclusive (or exclusive) scan of a copyable random-access stream into a vector,
+        // computed by `threads` threads; op must be associative, e.g. + or max, and whatever it
+        // throws is rethrown once all threads are done
+        template<typename Accumulator, typename Operation, typename E = ExtractorType, typename = std::enable_if_t<traits::IsRandomAccess<E>::value>>
+        std::vector<Accumulator> parallelScan(Accumulator init, Operation&& op, size_t threads = 0, bool inclusive = true) {
+            auto output = detail::parallelScan(extractor, std::move(init), op, threads, inclusive);
+            extractor.jump(output.size());
+            return output;
+        }
+
+        // the element at index, leaving the stream after it; nullopt and the end for SIZE_MAX
+        template<typename E = ExtractorType, typename = std::enable_if_t<traits::IsRandomAccess<E>::value>>
+        Optional<std::remove_const_t<value_type>> elementAt(size_t index) {
+            const size_t remaining = extractor.remaining();
+            if (index >= remaining) {
+                extractor.jump(remaining);
+                return nullopt;
+            }
+            extractor.jump(index);
+            extractor.advance();
+            return *extractor.get();
+        }
+
+        template<typename Accumulator, typename Fold>
+        Accumulator fold(Accumulator a, Fold&& fold) {
+            while (extractor.advance()) {
+                a = fold(a, *extractor.get());
+            }
+            return a;
+        }
+
+        // fold within a budget; pass the partial value back in to go on from where it stopped
+        template<typename Accumulator, typename Fold>
+        Partial<Accumulator> foldFor(const Budget& budget, Accumulator a, Fold&& fold) {
+            const Progress progress = detail::runFor(extractor, budget, [&a, &fold](auto& e) { a = fold(a, e); });
+            return { std::move(a), progress.processed, progress.finished };
+        }
+
+        template <template<class...> class Container = std::vector, typename Element = std::remove_const_t<value_type>>
+        auto collect() {
+            Container<Element> container;
+            while (extractor.advance()) {
+                container.push_back(*extractor.get());
+            }
+            return container;
+        }
+
+        // at most N elements into inline storage; a longer stream is truncated, its remaining
+        // elements are not pulled and can still be read with next()
+        template <size_t N, typename Element = std::remove_const_t<value_type>>
+        FixedVector<Element, N> collect() {
+            FixedVector<Element, N> container;
+            for (size_t i = 0; i != N && extractor.advance(); ++i) {
+                container.items[i] = *extractor.get();
+                container.length = i + 1;
+            }
+            return container;
+        }
+
+        template <typename Predicate, template<class...> class Container = std::vector, typename Element = std::remove_const_t<value_type>>
+        auto partition(Predicate&& predicate) {
+            std::pair<Container<Element>, Container<Element>> pair;
+            while (extractor.advance()) {
+                auto e = extractor.get();
+                if (predicate(*e)) {
+                    pair.first.push_back(*e);
+                } else {
+                    pair.second.push_back(*e);
+                }
+            }
+            return pair;
+        }
 
-        template<typename Comparator = std::less<std::remove_const_t<value_type>>>
-        Optional<std::remove_const_t<value_type>> min(Comparator cmp = {}) {
-            Optional<std::remove_const_t<value_type>> value {};
+        // sends every element to a Channel, waiting while it is full, and returns how many were
+        // sent; stops early if it gets closed. The channel is left open for other senders
+        template<typename Channel>
+        size_t sendTo(Channel& channel) {
+            size_t sent = 0;
+            while (extractor.advance() && channel.send(*extractor.get())) {
+                ++sent;
+            }
+            return sent;
+        }
+
+        // splits the stream into k buckets by bucketOf(e) in [0, k), keeping the order within each;
+        // a stream straight over a random-access container is read twice, the first time only to
+        // size the buckets
+        template <typename BucketFn, typename Element = std::remove_const_t<value_type>>
+        std::vector<std::vector<Element>> partitionBy(size_t k, BucketFn&& bucketOf) {
+            assert(k != 0 && k <= std::numeric_limits<uint32_t>::max());
+            std::vector<std::vector<Element>> buckets(k);
+            detail::partitionInto(extractor, buckets, bucketOf, detail::IsReIterable<ExtractorType>{});
+            return buckets;
+        }
+
+        // feeds every element to a sketch (see namespace sketch) and returns it, ready to be merged
+        template<typename Sketch>
+        Sketch sketch(Sketch s) {
             while (extractor.advance()) {
-                auto v = extractor.get();
-                if (!value || cmp(*v, *value)) { // nullopt is the least
-                    value = *v;
+                s.add(*extractor.get());
+            }
+            return s;
+        }
+
+        size_t approxDistinct(unsigned precision = 12) {
+            return static_cast<size_t>(std::llround(sketch(sketch::HyperLogLog(precision)).estimate()));
+        }
+
+        // empty result on an empty stream
+        auto approxQuantiles(const std::vector<double>& qs, size_t k = 200) {
+            auto s = sketch(sketch::Quantiles<std::remove_const_t<value_type>>(k));
+            return s.count() != 0 ? s.quantiles(qs) : std::vector<std::remove_const_t<value_type>>{};
+        }
+
+        auto sample(size_t k, uint64_t seed = 0) {
+            return sketch(sketch::Reservoir<std::remove_const_t<value_type>>(k, seed)).items;
+        }
+
+        template<typename OutputIterator>
+        OutputIterator copyTo(OutputIterator out) {
+            while (extractor.advance()) {
+                *out++ = *extractor.get();
+            }
+            return out;
+        }
+
+#if defined __unix__ || defined __APPLE__
+        // one element per line, formatted without iostreams for numbers and strings;
+        // false if anything could not be written
+        bool writeLines(int fd, io::WriteOptions options = {}) {
+            io::FdWriter writer(fd, options);
+            while (extractor.advance()) {
+                detail::appendText(writer, *extractor.get());
+                detail::appendText(writer, '\n');
+            }
+            return writer.finish();
+        }
+
+        bool writeLines(const std::string& path, io::WriteOptions options = {}) {
+            const int fd = ::open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+            if (fd < 0) {
+                return false;
+            }
+            const bool written = writeLines(fd, options);
+            return ::close(fd) == 0 && written;
+        }
+
+        // the raw bytes of every element
+        bool writeBinary(int fd, io::WriteOptions options = {}) {
+            using Element = std::remove_const_t<value_type>;
+            static_assert(std::is_trivially_copyable<Element>::value, "writeBinary expects trivially copyable elements");
+            io::FdWriter writer(fd, options);
+            while (extractor.advance()) {
+                writer.append(reinterpret_cast<const char*>(&*extractor.get()), sizeof(Element));
+            }
+            return writer.finish();
+        }
+#endif
+
+        // runs several collectors (see namespace collectors) over a single pass and returns a tuple
+        // of their results; the stream stops being pulled once every collector has retired
+        template<typename... Collectors>
+        auto fanout(Collectors... specs) {
+            static_assert(sizeof...(Collectors) != 0, "fanout expects at least one collector");
+            using Element = std::remove_const_t<value_type>;
+            auto collectors = std::make_tuple(specs.template bind<Element>()...);
+            bool active[sizeof...(Collectors)];
+            std::fill(active, active + sizeof...(Collectors), true);
+            size_t remaining = sizeof...(Collectors);
+            while (remaining != 0 && extractor.advance()) {
+                detail::fanoutAccept(collectors, active, remaining, *extractor.get(), std::index_sequence_for<Collectors...>{});
+            }
+            return detail::fanoutResults(collectors, std::index_sequence_for<Collectors...>{});
+        }
+
+        auto summarize() {
+            using Element = std::remove_const_t<value_type>;
+            Summary<Element> summary;
+            Element block[Summary<Element>::blockSize];
+            size_t size = 0;
+            while (extractor.advance()) {
+                block[size++] = *extractor.get();
+                if (size == Summary<Element>::blockSize) {
+                    summary.addBlock(block, size);
+                    size = 0;
+                }
+            }
+            summary.addBlock(block, size);
+            return summary;
+        }
+
+    };
+
+    template<typename Container>
+    auto from(const Container& container) {
+        using Extractor = SequenceStreamExtractor<decltype(std::begin(container))>;
+        return BaseStreamInterface<Extractor>(Extractor(std::begin(container), std::end(container)));
+    }
+
+    template<typename Container>
+    auto from(const Container&& container) = delete; // currently disastrous
+
+    namespace detail {
+        template<typename... Columns>
+        auto columnsOf(const Columns&... columns) {
+            using Extractor = ColumnsStreamExtractor<decltype(std::begin(columns))...>;
+            const size_t size = std::min({ static_cast<size_t>(std::distance(std::begin(columns), std::end(columns)))... });
+            return BaseStreamInterface<Extractor>(Extractor(std::make_tuple(std::begin(columns)...), size));
+        }
+    }
+
+    // rows across parallel random-access containers of which the shortest gives the stream length;
+    // as with from(), the containers must outlive the stream, so temporaries are refused
+    template<typename... Columns>
+    auto fromColumns(Columns&&... columns) {
+        static_assert(traits::AllOf<std::is_lvalue_reference<Columns>::value...>::value, "fromColumns() keeps iterators into its containers: they cannot be temporaries");
+        return detail::columnsOf(columns...);
+    }
+
+    // zip(s1, s2, ..., sN) yields flat Tuples and stops with the shortest stream
+    template<typename... Extractors>
+    auto zip(BaseStreamInterface<Extractors>... streams) {
+        static_assert(sizeof...(Extractors) != 0, "zip expects at least one stream");
+        using Extractor = ZipAllStreamExtractor<Extractors...>;
+        return BaseStreamInterface<Extractor>(Extractor(std::move(streams.extractor)...));
+    }
+
+    // chain(s1, s2, ..., sN) yields the elements of s1, then of s2, ...; all of the same type
+    template<typename... Extractors>
+    auto chain(BaseStreamInterface<Extractors>... streams) {
+        static_assert(sizeof...(Extractors) != 0, "chain expects at least one stream");
+        using Extractor = ChainAllStreamExtractor<Extractors...>;
+        return BaseStreamInterface<Extractor>(Extractor(std::move(streams.extractor)...));
+    }
+
+    namespace traits {
+        template<typename Type>
+        struct IsStream : std::false_type {};
+
+        template<typename ExtractorType>
+        struct IsStream<BaseStreamInterface<ExtractorType>> : std::true_type {};
+    }
+
+    // lazily merges streams, each sorted according to cmp, into one sorted stream
+    template<typename ExtractorType, typename Comparator = std::less<std::remove_const_t<typename BaseStreamInterface<ExtractorType>::value_type>>>
+    auto mergeSorted(const std::vector<BaseStreamInterface<ExtractorType>>& streams, Comparator cmp = {}) {
+        std::vector<ExtractorType> extractors;
+        extractors.reserve(streams.size());
+        for (auto& stream : streams) {
+            extractors.push_back(stream.extractor);
+        }
+        using Extractor = MergeSortedStreamExtractor<ExtractorType, Comparator>;
+        return BaseStreamInterface<Extractor>(Extractor(std::move(extractors), cmp));
+    }
+
+    namespace detail {
+        template<typename Tuple, size_t... I>
+        auto mergeSortedStreams(Tuple&& args, std::index_sequence<I...>, std::true_type /* no comparator */) {
+            using Stream = std::decay_t<std::tuple_element_t<0, std::decay_t<Tuple>>>;
+            return mergeSorted(std::vector<Stream>{ std::get<I>(args)..., std::get<sizeof...(I)>(args) });
+        }
+
+        template<typename Tuple, size_t... I>
+        auto mergeSortedStreams(Tuple&& args, std::index_sequence<I...>, std::false_type /* comparator is last */) {
+            using Stream = std::decay_t<std::tuple_element_t<0, std::decay_t<Tuple>>>;
+            return mergeSorted(std::vector<Stream>{ std::get<I>(args)... }, std::get<sizeof...(I)>(args));
+        }
+    }
+
+    // mergeSorted(s1, s2, ..., sN) or mergeSorted(s1, s2, ..., sN, cmp); all streams must be of the same type
+    template<typename ExtractorType, typename... Rest>
+    auto mergeSorted(const BaseStreamInterface<ExtractorType>& first, const Rest&... rest) {
+        using Last = std::tuple_element_t<sizeof...(Rest), Tuple<BaseStreamInterface<ExtractorType>, Rest...>>;
+        return detail::mergeSortedStreams(std::forward_as_tuple(first, rest...),
+                                          std::make_index_sequence<sizeof...(Rest)>{},
+                                          traits::IsStream<Last>{});
+    }
+
+    // A stage chain built once and applied to any number of sources. The functors are stored in
+    // the pipeline and the streams it produces refer to them (through std::reference_wrapper),
+    // so applying it copies no captured state; the pipeline must outlive those streams.
+    namespace stages {
+        template<typename Transform>
+        struct Map {
+            Transform transform;
+
+            template<typename Stream>
+            auto apply(Stream stream) {
+                return std::move(stream).map(std::ref(transform));
+            }
+        };
+
+        template<typename Transform>
+        struct FlatMap {
+            Transform transform;
+
+            template<typename Stream>
+            auto apply(Stream stream) {
+                return std::move(stream).flatMap(std::ref(transform));
+            }
+        };
+
+        template<typename Transform>
+        struct FilterMap {
+            Transform transform;
+
+            template<typename Stream>
+            auto apply(Stream stream) {
+                return std::move(stream).filterMap(std::ref(transform));
+            }
+        };
+
+        template<typename Predicate>
+        struct Filter {
+            Predicate predicate;
+
+            template<typename Stream>
+            auto apply(Stream stream) {
+                return std::move(stream).filter(std::ref(predicate));
+            }
+        };
+
+        template<typename Predicate>
+        struct SkipWhile {
+            Predicate predicate;
+
+            template<typename Stream>
+            auto apply(Stream stream) {
+                return std::move(stream).skipWhile(std::ref(predicate));
+            }
+        };
+
+        template<typename Predicate>
+        struct TakeWhile {
+            Predicate predicate;
+
+            template<typename Stream>
+            auto apply(Stream stream) {
+                return std::move(stream).takeWhile(std::ref(predicate));
+            }
+        };
+
+        template<typename Inspector>
+        struct Inspect {
+            Inspector inspector;
+
+            template<typename Stream>
+            auto apply(Stream stream) {
+                return std::move(stream).inspect(std::ref(inspector));
+            }
+        };
+
+        template<typename Inspector>
+        struct Spy {
+            Inspector inspector;
+
+            template<typename Stream>
+            auto apply(Stream stream) {
+                return std::move(stream).spy(std::ref(inspector));
+            }
+        };
+
+        struct Skip {
+            size_t count;
+
+            template<typename Stream>
+            auto apply(Stream stream) {
+                return std::move(stream).skip(count);
+            }
+        };
+
+        struct Take {
+            size_t count;
+
+            template<typename Stream>
+            auto apply(Stream stream) {
+                return std::move(stream).take(count);
+            }
+        };
+
+        struct Enumerate {
+            size_t from;
+
+            template<typename Stream>
+            auto apply(Stream stream) {
+                return std::move(stream).enumerate(from);
+            }
+        };
+    } // namespace stages
+
+    template<typename... Stages>
+    struct Pipeline {
+        Tuple<Stages...> stages;
+
+        template<typename Transform>
+        auto map(Transform&& transform) && {
+            return append(stages::Map<std::decay_t<Transform>>{ std::forward<Transform>(transform) });
+        }
+
+        template<typename Transform>
+        auto flatMap(Transform&& transform) && {
+            return append(stages::FlatMap<std::decay_t<Transform>>{ std::forward<Transform>(transform) });
+        }
+
+        template<typename Transform>
+        auto filterMap(Transform&& transform) && {
+            return append(stages::FilterMap<std::decay_t<Transform>>{ std::forward<Transform>(transform) });
+        }
+
+        template<typename Predicate>
+        auto filter(Predicate&& predicate) && {
+            return append(stages::Filter<std::decay_t<Predicate>>{ std::forward<Predicate>(predicate) });
+        }
+
+        template<typename Predicate>
+        auto skipWhile(Predicate&& predicate) && {
+            return append(stages::SkipWhile<std::decay_t<Predicate>>{ std::forward<Predicate>(predicate) });
+        }
+
+        template<typename Predicate>
+        auto takeWhile(Predicate&& predicate) && {
+            return append(stages::TakeWhile<std::decay_t<Predicate>>{ std::forward<Predicate>(predicate) });
+        }
+
+        template<typename Inspector>
+        auto inspect(Inspector&& inspector) && {
+            return append(stages::Inspect<std::decay_t<Inspector>>{ std::forward<Inspector>(inspector) });
+        }
+
+        template<typename Inspector>
+        auto spy(Inspector&& inspector) && {
+            return append(stages::Spy<std::decay_t<Inspector>>{ std::forward<Inspector>(inspector) });
+        }
+
+        auto skip(size_t count) && {
+            return append(stages::Skip{ count });
+        }
+
+        auto take(size_t count) && {
+            return append(stages::Take{ count });
+        }
+
+        auto enumerate(size_t from = 0) && {
+            return append(stages::Enumerate{ from });
+        }
+
+        template<typename ExtractorType>
+        auto operator () (BaseStreamInterface<ExtractorType> stream) & {
+            return apply(std::move(stream), std::integral_constant<size_t, 0>{});
+        }
+
+        // the functors would die with the temporary pipeline
+        template<typename ExtractorType>
+        auto operator () (BaseStreamInterface<ExtractorType> stream) && = delete;
+
+        template<typename Stage>
+        Pipeline<Stages..., Stage> append(Stage&& stage) {
+            return { std::tuple_cat(std::move(stages), std::make_tuple(std::forward<Stage>(stage))) };
+        }
+
+        template<typename Stream>
+        Stream apply(Stream stream, std::integral_constant<size_t, sizeof...(Stages)>) {
+            return stream;
+        }
+
+        template<typename Stream, size_t I>
+        auto apply(Stream stream, std::integral_constant<size_t, I>) {
+            return apply(std::get<I>(stages).apply(std::move(stream)), std::integral_constant<size_t, I + 1>{});
+        }
+    };
+
+    inline Pipeline<> pipe() {
+        return {};
+    }
+
+    template<typename ExtractorType, typename... Stages>
+    auto operator | (BaseStreamInterface<ExtractorType> stream, Pipeline<Stages...>& pipeline) {
+        return pipeline(std::move(stream));
+    }
+
+    template<typename Container, typename... Stages>
+    auto operator | (const Container& container, Pipeline<Stages...>& pipeline) {
+        return pipeline(from(container));
+    }
+
+    template<typename Container, typename... Stages>
+    auto operator | (const Container&& container, Pipeline<Stages...>& pipeline) = delete; // as from()
+
+
+    namespace detail {
+        // waiting without a lock: spin briefly, then give the core away, then sleep
+        struct Backoff {
+            unsigned rounds = 0;
+
+            void pause() {
+                if (rounds < 64) {
+#if defined __GNUC__ && (defined __x86_64__ || defined __i386__)
+                    __builtin_ia32_pause();
+#endif
+                } else if (rounds < 128) {
+                    std::this_thread::yield();
+                } else {
+                    std::this_thread::sleep_for(std::chrono::microseconds(50));
+                }
+                ++rounds;
+            }
+        };
+    }
+
+    template<typename T>
+    struct Channel;
+
+    template<typename T>
+    struct ChannelStreamExtractor : StreamExtractor<ChannelStreamExtractor<T>> {
+        explicit ChannelStreamExtractor(Channel<T>& channel) : channel(&channel) {}
+
+        Channel<T>* channel;
+        T value {};
+
+        T* get_impl() {
+            return &value;
+        }
+
+        // blocks until an element arrives or the channel is closed and drained
+        bool advance_impl() {
+            return channel->receive(value);
+        }
+    };
+
+    // Bounded lock-free multi-producer multi-consumer queue (Vyukov's ring: every cell carries a
+    // sequence number telling whose turn it is). close() is for after the last send; receivers
+    // then drain what is left and stop. T must be default constructible.
+    template<typename T>
+    struct Channel {
+        struct Cell {
+            std::atomic<size_t> sequence;
+            T value;
+        };
+
+        // capacity is rounded up to a power of two
+        explicit Channel(size_t capacity = 1024) : mask(roundUp(std::max<size_t>(capacity, 2)) - 1), cells(mask + 1) {
+            for (size_t i = 0; i != cells.size(); ++i) {
+                cells[i].sequence.store(i, std::memory_order_relaxed);
+            }
+        }
+
+        Channel(const Channel&) = delete;
+        Channel& operator = (const Channel&) = delete;
+
+        const size_t mask;
+        std::vector<Cell> cells;
+        // producers and consumers update different cache lines
+        char padding0[64];
+        std::atomic<size_t> sendPosition { 0 };
+        char padding1[64 - sizeof(std::atomic<size_t>)];
+        std::atomic<size_t> receivePosition { 0 };
+        char padding2[64 - sizeof(std::atomic<size_t>)];
+        std::atomic<bool> isClosed { false };
+
+        static size_t roundUp(size_t n) {
+            size_t power = 1;
+            while (power < n) {
+                power <<= 1;
+            }
+            return power;
+        }
+
+        // false when the channel is full
+        template<typename U>
+        bool trySend(U&& value) {
+            size_t position = sendPosition.load(std::memory_order_relaxed);
+            for (;;) {
+                Cell& cell = cells[position & mask];
+                const size_t sequence = cell.sequence.load(std::memory_order_acquire);
+                const auto turn = static_cast<std::ptrdiff_t>(sequence - position);
+                if (turn == 0) {
+                    if (sendPosition.compare_exchange_weak(position, position + 1, std::memory_order_relaxed)) {
+                        cell.value = std::forward<U>(value);
+                        cell.sequence.store(position + 1, std::memory_order_release);
+                        return true;
+                    }
+                } else if (turn < 0) {
+                    return false;
+                } else {
+                    position = sendPosition.load(std::memory_order_relaxed);
+                }
+            }
+        }
+
+        // false when the channel is empty
+        bool tryReceive(T& out) {
+            size_t position = receivePosition.load(std::memory_order_relaxed);
+            for (;;) {
+                Cell& cell = cells[position & mask];
+                const size_t sequence = cell.sequence.load(std::memory_order_acquire);
+                const auto turn = static_cast<std::ptrdiff_t>(sequence - (position + 1));
+                if (turn == 0) {
+                    if (receivePosition.compare_exchange_weak(position, position + 1, std::memory_order_relaxed)) {
+                        out = std::move(cell.value);
+                        cell.sequence.store(position + mask + 1, std::memory_order_release);
+                        return true;
+                    }
+                } else if (turn < 0) {
+                    return false;
+                } else {
+                    position = receivePosition.load(std::memory_order_relaxed);
+                }
+            }
+        }
+
+        // waits for room; false if the channel is closed
+        template<typename U>
+        bool send(U&& value) {
+            detail::Backoff backoff;
+            while (!closed()) {
+                if (trySend(std::forward<U>(value))) { // moves only once a cell is taken
+                    if (trace::enabled()) {
+                        trace::counter("channel depth", static_cast<int64_t>(sendPosition.load(std::memory_order_relaxed) - receivePosition.load(std::memory_order_relaxed)));
+                    }
+                    return true;
+                }
+                backoff.pause();
+            }
+            return false;
+        }
+
+        // waits for an element; false once the channel is closed and empty
+        bool receive(T& out) {
+            detail::Backoff backoff;
+            while (!tryReceive(out)) {
+                if (closed()) {
+                    return tryReceive(out); // sent just before close()
+                }
+                backoff.pause();
+            }
+            return true;
+        }
+
+        Optional<T> receive() {
+            T value;
+            if (receive(value)) {
+                return Optional<T>(std::move(value));
+            }
+            return nullopt;
+        }
+
+        void close() {
+            isClosed.store(true, std::memory_order_release);
+        }
+
+        bool closed() const {
+            return isClosed.load(std::memory_order_acquire);
+        }
+
+        // the elements as they arrive, ending when the channel is closed and drained; several
+        // streams over one channel share its elements
+        auto stream() {
+            using Extractor = ChannelStreamExtractor<T>;
+            return BaseStreamInterface<Extractor>(Extractor(*this));
+        }
+    };
+
+#if defined __unix__ || defined __APPLE__
+    // records of a file split by a delimiter, found with memchr in the chunks of an io::ChunkReader;
+    // a record is a view into the chunk, or into a copy when it spans two chunks, valid until the
+    // next advance(). Move-only.
+    struct RecordsStreamExtractor : StreamExtractor<RecordsStreamExtractor> {
+        RecordsStreamExtractor(std::unique_ptr<io::ChunkReader> reader, char delimiter) : reader(std::move(reader)), delimiter(delimiter) {}
+
+        std::unique_ptr<io::ChunkReader> reader;
+        char delimiter;
+        const char* chunk = nullptr;
+        size_t size = 0;
+        size_t position = 0;
+        std::string spanning;
+        StringView record;
+
+        StringView* get_impl() {
+            return &record;
+        }
+
+        bool advance_impl() {
+            if (record.data() == spanning.data()) {
+                spanning.clear();
+            }
+            for (;;) {
+                const char* begin = chunk + position;
+                const void* end = position != size ? std::memchr(begin, delimiter, size - position) : nullptr;
+                if (end != nullptr) {
+                    const size_t length = static_cast<size_t>(static_cast<const char*>(end) - begin);
+                    position += length + 1;
+                    if (spanning.empty()) {
+                        record = StringView(begin, length);
+                    } else {
+                        spanning.append(begin, length);
+                        record = StringView(spanning.data(), spanning.size());
+                    }
+                    return true;
+                }
+                if (position != size) {
+                    spanning.append(begin, size - position);
+                }
+                position = 0;
+                if (!reader->read(chunk, size)) {
+                    size = 0;
+                    if (spanning.empty()) {
+                        return false;
+                    }
+                    record = StringView(spanning.data(), spanning.size()); // no delimiter at the end
+                    return true;
                 }
             }
-            return value;
         }
+    };
 
-        template<typename Comparator = std::greater<std::remove_const_t<value_type>>>
-        Optional<std::remove_const_t<value_type>> max(Comparator cmp = {}) {
-            return min(cmp);
+    namespace io {
+        // the lines of a file, read in chunks in the background (see ChunkReader); an unreadable
+        // file gives an empty stream, stream.extractor.reader->failed tells the two apart
+        inline auto lines(const std::string& path, ReadOptions options = {}, char delimiter = '\n') {
+            return BaseStreamInterface<RecordsStreamExtractor>(RecordsStreamExtractor(std::make_unique<ChunkReader>(path, options), delimiter));
         }
+    }
+#endif
 
-        template<typename Predicate>
-        Optional<std::remove_const_t<value_type>> find(Predicate&& predicate) {
-            while (extractor.advance()) {
-                auto e = extractor.get();
-                if (predicate(*e)) {
-                    return *e;
-                }
-            }
-            return nullopt;
+
+    template<typename T>
+    struct Block {
+        const T* data;
+        size_t size;
+
+        const T* begin() const noexcept {
+            return data;
         }
 
-        template<typename Predicate>
-        Optional<size_t> position(Predicate&& predicate) {
-            size_t counter = 0;
-            while (extractor.advance()) {
-                ++counter;
-                if (predicate(*extractor.get())) {
-                    return counter;
-                }
+        const T* end() const noexcept {
+            return data + size;
+        }
+    };
+
+    // Sources over a block decoder: an object with value_type and `size_t decode(value_type* out,
+    // size_t capacity)`, which writes the next values and returns their count, 0 once exhausted.
+    // Values are decoded a block at a time into a buffer owned by the extractor, so they are
+    // still in L1 when the downstream stages read them.
+    template<typename Decoder, size_t BlockSize = 128>
+    struct DecodeStreamExtractor : StreamExtractor<DecodeStreamExtractor<Decoder, BlockSize>> {
+        DecodeStreamExtractor(Decoder decoder) : decoder(decoder) {}
+
+        using value_type = typename Decoder::value_type;
+
+        Decoder decoder;
+        size_t position = 0;
+        size_t size = 0;
+        value_type buffer[BlockSize];
+
+        auto get_impl() noexcept {
+            return &buffer[position];
+        }
+
+        bool advance_impl() {
+            if (++position < size) {
+                return true;
             }
-            return nullopt;
+            position = 0;
+            size = decoder.decode(buffer, BlockSize);
+            return size != 0;
         }
+    };
 
-        template<typename Accumulator, typename Fold>
-        Accumulator fold(Accumulator a, Fold&& fold) {
-            while (extractor.advance()) {
-                a = fold(a, *extractor.get());
+    // yields whole decoded blocks, for stages that work on a batch at a time
+    template<typename Decoder, size_t BlockSize = 128>
+    struct DecodeBlocksStreamExtractor : StreamExtractor<DecodeBlocksStreamExtractor<Decoder, BlockSize>> {
+        DecodeBlocksStreamExtractor(Decoder decoder) : decoder(decoder) {}
+
+        using value_type = typename Decoder::value_type;
+
+        Decoder decoder;
+        size_t size = 0;
+        Block<value_type> block {};
+        value_type buffer[BlockSize];
+
+        auto get_impl() noexcept {
+            block = { buffer, size };
+            return &block;
+        }
+
+        bool advance_impl() {
+            size = decoder.decode(buffer, BlockSize);
+            return size != 0;
+        }
+    };
+
+    namespace detail {
+        inline uint64_t loadLittleEndian64(const uint8_t* bytes) noexcept {
+            uint64_t word;
+            std::memcpy(&word, bytes, sizeof(word));
+#if defined __BYTE_ORDER__ && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+            word = __builtin_bswap64(word);
+#endif
+            return word;
+        }
+
+        // `width` bits starting at bit `offset` of an LSB-first packed buffer of `size` bytes
+        inline uint64_t readBits(const uint8_t* data, size_t size, size_t offset, unsigned width) noexcept {
+            const uint64_t mask = width == 64 ? ~uint64_t(0) : (uint64_t(1) << width) - 1;
+            const size_t byte = offset / 8;
+            const unsigned shift = static_cast<unsigned>(offset % 8);
+            if (byte + 8 <= size && shift + width <= 64) {
+                return (loadLittleEndian64(data + byte) >> shift) & mask;
             }
-            return a;
+            uint64_t result = 0;
+            for (unsigned bit = 0; bit < width; ++bit) {
+                const size_t at = offset + bit;
+                result |= uint64_t((data[at / 8] >> (at % 8)) & 1) << bit;
+            }
+            return result;
         }
 
-        template <template<class...> class Container = std::vector, typename Element = std::remove_const_t<value_type>>
-        auto collect() {
-            Container<Element> container;
-            while (extractor.advance()) {
-                container.push_back(*extractor.get());
+        // unpacks count values of `width` bits, starting with value number `first`
+        inline void unpackBits(const uint8_t* data, size_t size, unsigned width, size_t first, size_t count, uint64_t* out) noexcept {
+            for (size_t i = 0; i < count; ++i) {
+                out[i] = width == 0 ? 0 : readBits(data, size, (first + i) * width, width);
             }
-            return container;
         }
+    }
 
-        template <typename Predicate, template<class...> class Container = std::vector, typename Element = std::remove_const_t<value_type>>
-        auto partition(Predicate&& predicate) {
-            std::pair<Container<Element>, Container<Element>> pair;
-            while (extractor.advance()) {
-                auto e = extractor.get();
-                if (predicate(*e)) {
-                    pair.first.push_back(*e);
-                } else {
-                    pair.second.push_back(*e);
+    namespace decode {
+
+        // unsigned LEB128
+        struct VarintDecoder {
+            using value_type = uint64_t;
+
+            VarintDecoder(const uint8_t* data, size_t size) : current(data), end(data + size) {}
+
+            const uint8_t* current;
+            const uint8_t* end;
+
+            size_t decode(uint64_t* out, size_t capacity) noexcept {
+                size_t n = 0;
+                while (n < capacity && current != end) {
+                    // fast path: eight one-byte values at once when no continuation bit is set
+                    if (n + 8 <= capacity && end - current >= 8) {
+                        const uint64_t word = detail::loadLittleEndian64(current);
+                        if ((word & 0x8080808080808080ULL) == 0) {
+                            for (size_t i = 0; i < 8; ++i) {
+                                out[n + i] = (word >> (8 * i)) & 0xff;
+                            }
+                            n += 8;
+                            current += 8;
+                            continue;
+                        }
+                    }
+                    uint64_t value = 0;
+                    for (unsigned shift = 0; current != end; shift += 7) {
+                        const uint8_t byte = *current++;
+                        if (shift < 64) {
+                            value |= uint64_t(byte & 0x7f) << shift;
+                        }
+                        if (!(byte & 0x80)) {
+                            break;
+                        }
+                    }
+                    out[n++] = value;
                 }
+                return n;
             }
-            return pair;
+        };
+
+        // LEB128 varints of zigzag-encoded differences to the previous value (the first one to 0)
+        struct DeltaZigzagDecoder {
+            using value_type = int64_t;
+
+            DeltaZigzagDecoder(const uint8_t* data, size_t size) : varint(data, size) {}
+
+            VarintDecoder varint;
+            int64_t last = 0;
+
+            size_t decode(int64_t* out, size_t capacity) noexcept {
+                static_assert(sizeof(int64_t) == sizeof(uint64_t), "decoded in place");
+                uint64_t* raw = reinterpret_cast<uint64_t*>(out);
+                const size_t n = varint.decode(raw, capacity);
+                for (size_t i = 0; i < n; ++i) {
+                    const uint64_t zigzag = raw[i];
+                    last += static_cast<int64_t>((zigzag >> 1) ^ (~(zigzag & 1) + 1));
+                    out[i] = last;
+                }
+                return n;
+            }
+        };
+
+        // base + an unsigned offset of `width` bits per value, packed LSB first
+        struct FrameOfReferenceDecoder {
+            using value_type = int64_t;
+
+            FrameOfReferenceDecoder(const uint8_t* data, size_t count, unsigned width, int64_t base)
+                : data(data), bytes((count * width + 7) / 8), count(count), width(width), base(base) {
+                assert(width <= 64);
+            }
+
+            const uint8_t* data;
+            size_t bytes;
+            size_t count;
+            unsigned width;
+            int64_t base;
+            size_t index = 0;
+
+            size_t decode(int64_t* out, size_t capacity) noexcept {
+                const size_t n = std::min(capacity, count - index);
+                uint64_t* raw = reinterpret_cast<uint64_t*>(out);
+                detail::unpackBits(data, bytes, width, index, n, raw);
+                for (size_t i = 0; i < n; ++i) {
+                    out[i] = static_cast<int64_t>(static_cast<uint64_t>(base) + raw[i]);
+                }
+                index += n;
+                return n;
+            }
+        };
+
+        // bit-packed codes into a dictionary of strings, which must outlive the stream
+        struct DictionaryDecoder {
+            using value_type = StringView;
+
+            DictionaryDecoder(const uint8_t* codes, size_t count, unsigned width, const std::vector<StringView>& dictionary)
+                : codes(codes), bytes((count * width + 7) / 8), count(count), width(width), dictionary(dictionary.data()), dictionarySize(dictionary.size()) {}
+
+            const uint8_t* codes;
+            size_t bytes;
+            size_t count;
+            unsigned width;
+            const StringView* dictionary;
+            size_t dictionarySize;
+            size_t index = 0;
+
+            size_t decode(StringView* out, size_t capacity) noexcept {
+                uint64_t raw[64];
+                size_t n = 0;
+                while (n < capacity && index < count) {
+                    const size_t chunk = std::min({ capacity - n, count - index, size_t(64) });
+                    detail::unpackBits(codes, bytes, width, index, chunk, raw);
+                    for (size_t i = 0; i < chunk; ++i) {
+                        assert(raw[i] < dictionarySize);
+                        out[n + i] = dictionary[raw[i]];
+                    }
+                    n += chunk;
+                    index += chunk;
+                }
+                return n;
+            }
+        };
+
+        template<typename Decoder>
+        auto values(Decoder decoder) {
+            return BaseStreamInterface<DecodeStreamExtractor<Decoder>>(DecodeStreamExtractor<Decoder>(decoder));
         }
 
-    };
+        template<typename Decoder>
+        auto blocks(Decoder decoder) {
+            return BaseStreamInterface<DecodeBlocksStreamExtractor<Decoder>>(DecodeBlocksStreamExtractor<Decoder>(decoder));
+        }
 
-    template<typename Container>
-    auto from(const Container& container) {
-        using Extractor = SequenceStreamExtractor<decltype(std::begin(container))>;
-        return BaseStreamInterface<Extractor>(Extractor(std::begin(container), std::end(container)));
-    }
+        inline auto varint(const uint8_t* data, size_t size) {
+            return values(VarintDecoder(data, size));
+        }
+
+        inline auto deltaZigzag(const uint8_t* data, size_t size) {
+            return values(DeltaZigzagDecoder(data, size));
+        }
+
+        inline auto frameOfReference(const uint8_t* data, size_t count, unsigned width, int64_t base) {
+            return values(FrameOfReferenceDecoder(data, count, width, base));
+        }
+
+        inline auto dictionary(const uint8_t* codes, size_t count, unsigned width, const std::vector<StringView>& entries) {
+            return values(DictionaryDecoder(codes, count, width, entries));
+        }
+
+    } // namespace decode
 
-    template<typename Container>
-    auto from(const Container&& container) = delete; // currently disastrous
 
     inline namespace generators {
         struct CounterGenerator : StreamExtractor<CounterGenerator> {
@@ -709,6 +4968,152 @@ namespace streams {
                 current++;
                 return true;
             }
+
+            size_t remaining_impl() const noexcept {
+                return std::numeric_limits<size_t>::max();
+            }
+
+            void jump_impl(size_t n) noexcept {
+                current += n;
+            }
+        };
+
+        // begin, begin + step, ... up to end (exclusive); elements are computed from their index,
+        // so floating-point ranges do not accumulate rounding errors
+        template<typename T>
+        struct RangeGenerator : StreamExtractor<RangeGenerator<T>> {
+            RangeGenerator(T begin, T end, T step) : begin(begin), step(step), size(count(begin, end, step)) {
+                assert(step != T(0));
+            }
+
+            T begin;
+            T step;
+            size_t size;
+            size_t index = 0;
+            T value {};
+
+            static size_t count(T begin, T end, T step) noexcept {
+                if (step > T(0) ? !(begin < end) : !(end < begin)) {
+                    return 0;
+                }
+                return static_cast<size_t>(std::ceil(static_cast<long double>(end - begin) / static_cast<long double>(step)));
+            }
+
+            auto get_impl() noexcept {
+                return &value;
+            }
+
+            bool advance_impl() noexcept {
+                if (index == size) {
+                    return false;
+                }
+                value = static_cast<T>(begin + static_cast<T>(index++) * step);
+                return true;
+            }
+
+            size_t remaining_impl() const noexcept {
+                return size - index;
+            }
+
+            void jump_impl(size_t n) noexcept {
+                index += n;
+            }
+        };
+
+        // seed, f(seed), f(f(seed)), ...
+        template<typename T, typename Function>
+        struct IterateGenerator : StreamExtractor<IterateGenerator<T, Function>> {
+            IterateGenerator(T seed, Function&& f) : value(std::move(seed)), function(std::forward<Function>(f)) {}
+
+            T value;
+            Function function;
+            bool started = false;
+
+            auto get_impl() noexcept {
+                return &value;
+            }
+
+            bool advance_impl() {
+                if (started) {
+                    value = function(value);
+                }
+                started = true;
+                return true;
+            }
+        };
+
+        template<typename T>
+        struct RepeatGenerator : StreamExtractor<RepeatGenerator<T>> {
+            RepeatGenerator(T value) : value(std::move(value)) {}
+
+            T value;
+
+            auto get_impl() noexcept {
+                return &value;
+            }
+
+            bool advance_impl() noexcept {
+                return true;
+            }
+
+            size_t remaining_impl() const noexcept {
+                return std::numeric_limits<size_t>::max();
+            }
+
+            void jump_impl(size_t) noexcept {}
+        };
+
+        // Counter-based Philox4x32-10 (Salmon et al., "Parallel random numbers: as easy as 1, 2, 3").
+        // The i-th number of a substream is a pure function of (seed, substream, i), so any position
+        // of any substream is reached in O(1): jump() ahead, or give each worker its own substream.
+        struct PhiloxGenerator : StreamExtractor<PhiloxGenerator> {
+            using Block = std::array<uint32_t, 4>;
+
+            PhiloxGenerator(uint64_t seed, uint64_t substream)
+                : key{ { static_cast<uint32_t>(seed), static_cast<uint32_t>(seed >> 32) } }, substream(substream) {}
+
+            std::array<uint32_t, 2> key;
+            uint64_t substream;
+            uint64_t index = std::numeric_limits<uint64_t>::max(); // of the current number, two per block
+            uint64_t cached = std::numeric_limits<uint64_t>::max(); // index of the block below
+            Block block {};
+            uint64_t value = 0;
+
+            static Block generate(Block counter, std::array<uint32_t, 2> key) noexcept {
+                for (int round = 0; round < 10; ++round) {
+                    const uint64_t p0 = uint64_t(0xD2511F53) * counter[0];
+                    const uint64_t p1 = uint64_t(0xCD9E8D57) * counter[2];
+                    counter = { { static_cast<uint32_t>(p1 >> 32) ^ counter[1] ^ key[0], static_cast<uint32_t>(p1),
+                                  static_cast<uint32_t>(p0 >> 32) ^ counter[3] ^ key[1], static_cast<uint32_t>(p0) } };
+                    key[0] += 0x9E3779B9;
+                    key[1] += 0xBB67AE85;
+                }
+                return counter;
+            }
+
+            auto get_impl() noexcept {
+                return &value;
+            }
+
+            bool advance_impl() noexcept {
+                const uint64_t blockIndex = ++index / 2;
+                if (blockIndex != cached) {
+                    block = generate({ { static_cast<uint32_t>(blockIndex), static_cast<uint32_t>(blockIndex >> 32),
+                                         static_cast<uint32_t>(substream), static_cast<uint32_t>(substream >> 32) } }, key);
+                    cached = blockIndex;
+                }
+                const size_t half = static_cast<size_t>(index % 2) * 2;
+                value = (uint64_t(block[half + 1]) << 32) | block[half];
+                return true;
+            }
+
+            size_t remaining_impl() const noexcept {
+                return std::numeric_limits<size_t>::max();
+            }
+
+            void jump_impl(size_t n) noexcept {
+                index += n;
+            }
         };
 
     } // namespace generators
@@ -718,8 +5123,229 @@ namespace streams {
             return BaseStreamInterface<CounterGenerator>(CounterGenerator(from));
         }
 
+        // sized and random-access, for any arithmetic type
+        template<typename Begin, typename End, typename Step = int>
+        static auto range(Begin begin, End end, Step step = 1) {
+            using T = std::common_type_t<Begin, End, Step>;
+            return BaseStreamInterface<RangeGenerator<T>>(RangeGenerator<T>(static_cast<T>(begin), static_cast<T>(end), static_cast<T>(step)));
+        }
+
+        template<typename T, typename Function>
+        static auto iterate(T seed, Function&& f) {
+            using Extractor = IterateGenerator<T, Function>;
+            return BaseStreamInterface<Extractor>(Extractor(std::move(seed), std::forward<Function>(f)));
+        }
+
+        template<typename T>
+        static auto repeat(T value) {
+            return BaseStreamInterface<RepeatGenerator<T>>(RepeatGenerator<T>(std::move(value)));
+        }
+
+        // endless stream of uniformly distributed 64-bit numbers
+        static auto philox(uint64_t seed, uint64_t substream = 0) {
+            return BaseStreamInterface<PhiloxGenerator>(PhiloxGenerator(seed, substream));
+        }
+
     }; // struct generate
 
+#if defined STREAMS_COROUTINES
+    namespace detail {
+        // written past the end of every coroutine frame: how to give the frame back
+        struct FrameFooter {
+            void (*release)(void* allocator, void* frame, size_t bytes);
+            void* allocator;
+        };
+
+        inline size_t footerOffset(size_t size) {
+            return (size + alignof(FrameFooter) - 1) / alignof(FrameFooter) * alignof(FrameFooter);
+        }
+
+        template<typename Allocator>
+        void* allocateFrame(size_t size, Allocator& allocator) {
+            const size_t bytes = footerOffset(size) + sizeof(FrameFooter);
+            void* frame = allocator.allocate(bytes);
+            auto release = [](void* allocator, void* frame, size_t bytes) {
+                static_cast<Allocator*>(allocator)->deallocate(frame, bytes);
+            };
+            new(static_cast<char*>(frame) + footerOffset(size)) FrameFooter{ release, &allocator };
+            return frame;
+        }
+
+        inline void releaseFrame(void* frame, size_t size) {
+            const FrameFooter footer = *reinterpret_cast<FrameFooter*>(static_cast<char*>(frame) + footerOffset(size));
+            footer.release(footer.allocator, frame, footerOffset(size) + sizeof(FrameFooter));
+        }
+
+        // recycles coroutine frames of one thread in 64-byte size classes up to 1 KiB, so that a
+        // generator created and destroyed in a loop reuses its block
+        struct FramePool {
+            static constexpr size_t granularity = 64;
+            static constexpr size_t classes = 16;
+
+            std::array<void*, classes> free{};
+
+            FramePool() = default;
+            FramePool(const FramePool&) = delete;
+            FramePool& operator = (const FramePool&) = delete;
+
+            ~FramePool() {
+                for (void* block : free) {
+                    while (block != nullptr) {
+                        void* next = *static_cast<void**>(block);
+                        ::operator delete(block);
+                        block = next;
+                    }
+                }
+            }
+
+            void* allocate(size_t bytes) {
+                const size_t sizeClass = (bytes - 1) / granularity;
+                if (sizeClass >= classes) {
+                    return ::operator new(bytes);
+                }
+                if (void* block = free[sizeClass]) {
+                    free[sizeClass] = *static_cast<void**>(block);
+                    return block;
+                }
+                return ::operator new((sizeClass + 1) * granularity);
+            }
+
+            void deallocate(void* block, size_t bytes) {
+                const size_t sizeClass = (bytes - 1) / granularity;
+                if (sizeClass >= classes) {
+                    ::operator delete(block);
+                    return;
+                }
+                *static_cast<void**>(block) = free[sizeClass];
+                free[sizeClass] = block;
+            }
+        };
+
+        inline FramePool& framePool() {
+            thread_local FramePool pool;
+            return pool;
+        }
+
+        // the default frame allocator: frames come from the pool of the thread creating them and
+        // go back to the pool of the thread releasing them, so a generator may be destroyed on
+        // another thread and outlive the one that created it
+        struct ThreadFramePool {
+            void* allocate(size_t bytes) { return framePool().allocate(bytes); }
+            void deallocate(void* block, size_t bytes) { framePool().deallocate(block, bytes); }
+        };
+
+        inline ThreadFramePool& threadFramePool() {
+            static ThreadFramePool pool;
+            return pool;
+        }
+    }
+
+    inline namespace generators {
+        // A coroutine that co_yields the elements of a stream; from(coroutine) turns it into one.
+        // co_yield hands out the address of what it is given, so neither lvalues nor temporaries
+        // are copied, and generator<const Node&> yields references into a structure. Frames come
+        // from the thread's FramePool, or from any object with allocate(bytes) and
+        // deallocate(p, bytes) passed after std::allocator_arg as the first two arguments of the
+        // coroutine. A compiler that sees the whole lifetime of the frame may elide the allocation.
+        // An exception thrown by the body reaches whoever advances the stream.
+        template<typename T>
+        struct generator {
+            using value_type = std::remove_cv_t<std::remove_reference_t<T>>;
+            using reference = std::conditional_t<std::is_reference<T>::value, T, const value_type&>;
+            using pointer = std::add_pointer_t<reference>;
+
+            struct promise_type {
+                pointer current = nullptr;
+                std::exception_ptr exception;
+
+                generator get_return_object() noexcept {
+                    return generator(std::coroutine_handle<promise_type>::from_promise(*this));
+                }
+
+                std::suspend_always initial_suspend() const noexcept { return {}; }
+                std::suspend_always final_suspend() const noexcept { return {}; }
+
+                std::suspend_always yield_value(reference value) noexcept {
+                    current = std::addressof(value);
+                    return {};
+                }
+
+                void return_void() const noexcept {}
+                void unhandled_exception() noexcept { exception = std::current_exception(); }
+
+                // a generator only yields
+                template<typename Awaitable>
+                void await_transform(Awaitable&&) = delete;
+
+                static void* operator new(size_t size) {
+                    return detail::allocateFrame(size, detail::threadFramePool());
+                }
+
+                // inlined so that GCC at -O0 does not take the usual operator delete for a
+                // mismatched one (-Wmismatched-new-delete)
+                template<typename Allocator, typename... Args>
+                [[gnu::always_inline]] static void* operator new(size_t size, std::allocator_arg_t, Allocator& allocator, Args&...) {
+                    return detail::allocateFrame(size, allocator);
+                }
+
+                static void operator delete(void* frame, size_t size) {
+                    detail::releaseFrame(frame, size);
+                }
+            };
+
+            explicit generator(std::coroutine_handle<promise_type> handle) : handle(handle) {}
+            generator(generator&& other) noexcept : handle(std::exchange(other.handle, {})) {}
+
+            generator& operator = (generator&& other) noexcept {
+                std::swap(handle, other.handle);
+                return *this;
+            }
+
+            ~generator() {
+                if (handle) {
+                    handle.destroy();
+                }
+            }
+
+            std::coroutine_handle<promise_type> handle;
+
+            // runs the coroutine to its next co_yield; false once it has returned, and what it
+            // threw is rethrown here
+            bool next() {
+                if (!handle || handle.done()) {
+                    return false;
+                }
+                handle.resume();
+                if (handle.promise().exception) {
+                    std::rethrow_exception(std::exchange(handle.promise().exception, nullptr));
+                }
+                return !handle.done();
+            }
+        };
+
+        template<typename T>
+        struct CoroutineGenerator : StreamExtractor<CoroutineGenerator<T>> {
+            CoroutineGenerator(generator<T>&& coroutine) : coroutine(std::move(coroutine)) {}
+
+            generator<T> coroutine;
+
+            auto get_impl() noexcept {
+                return coroutine.handle.promise().current;
+            }
+
+            bool advance_impl() {
+                return coroutine.next();
+            }
+        };
+    } // namespace generators
+
+    // the stream owns the coroutine, so it is move-only: chain it with the && stages
+    template<typename T>
+    auto from(generator<T>&& coroutine) {
+        return BaseStreamInterface<CoroutineGenerator<T>>(CoroutineGenerator<T>(std::move(coroutine)));
+    }
+#endif // STREAMS_COROUTINES
+
 
 } // namespace streams
 
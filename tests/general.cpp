@@ -4,6 +4,8 @@
 #include <numeric>
 #include <utility>
 #include <list>
+#include <forward_list>
+#include <stdexcept>
 #include <iostream>
 #include "../Streams.h"
 #include "gtest/gtest.h"
@@ -167,6 +169,20 @@ TEST_F(GeneralTests, SkipSome) {
     ASSERT_EQ(check, vec);
 }
 
+TEST_F(GeneralTests, SkipPastEnd) {
+    std::vector<int> shortVector{ 1, 2, 3 };
+    ASSERT_FALSE(streams::from(shortVector).skip(10).nth(0));
+    ASSERT_FALSE(streams::from(shortVector).skip(10).nth(2));
+    ASSERT_EQ(0u, streams::from(shortVector).skip(10).count());
+    ASSERT_FALSE(streams::from(shortVector).skip(10).parallelFind([](int e) { return e > 0; }, 2));
+    ASSERT_FALSE(streams::from(shortVector).skip(10).map([](int e) { return e * 2; }).elementAt(0));
+
+    auto stream = streams::from(shortVector).skip(10);
+    stream.extractor.jump(0);
+    ASSERT_EQ(0u, stream.extractor.remaining());
+    ASSERT_FALSE(stream.next());
+}
+
 
 TEST_F(GeneralTests, SkipWhileAll) {
     auto vec = getStream()
@@ -658,6 +674,1558 @@ TEST_F(GeneralTests, GeneratorCounter) {
 
 
 
+TEST_F(GeneralTests, MergeSorted) {
+    std::vector<int> a{ 1, 4, 7, 10 };
+    std::vector<int> b{ 2, 5, 8 };
+    std::vector<int> c{ 0, 3, 6, 9, 11, 12 };
+
+    auto res = streams::mergeSorted(streams::from(a), streams::from(b), streams::from(c)).collect();
+
+    std::vector<int> check{ 0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12 };
+    ASSERT_EQ(check, res);
+}
+
+TEST_F(GeneralTests, MergeSortedComparator) {
+    std::vector<int> a{ 9, 5, 1 };
+    std::vector<int> b{ 8, 7, 6, 2 };
+
+    auto res = streams::mergeSorted(streams::from(a), streams::from(b), std::greater<int>{}).collect();
+
+    std::vector<int> check{ 9, 8, 7, 6, 5, 2, 1 };
+    ASSERT_EQ(check, res);
+}
+
+TEST_F(GeneralTests, MergeSortedVector) {
+    std::vector<std::vector<int>> shards{ {}, { 5, 5, 6 }, {}, { 1, 5 }, { 2 }, {} };
+    std::vector<decltype(getStream())> streams;
+    for (auto& shard : shards) {
+        streams.push_back(streams::from(shard));
+    }
+
+    auto res = streams::mergeSorted(streams).collect();
+
+    std::vector<int> check{ 1, 2, 5, 5, 5, 6 };
+    ASSERT_EQ(check, res);
+    ASSERT_EQ(0, streams::mergeSorted(std::vector<decltype(getStream())>{}).count());
+}
+
+TEST_F(GeneralTests, MergeSortedStable) {
+    using Pair = std::pair<int, int>;
+    std::vector<Pair> a{ { 1, 0 }, { 2, 0 } };
+    std::vector<Pair> b{ { 1, 1 }, { 2, 1 } };
+    auto byKey = [](auto&& lhs, auto&& rhs) { return lhs.first < rhs.first; };
+
+    auto res = streams::mergeSorted(streams::from(a), streams::from(b), byKey).collect();
+
+    std::vector<Pair> check{ { 1, 0 }, { 1, 1 }, { 2, 0 }, { 2, 1 } };
+    ASSERT_EQ(check, res);
+}
+
+
+
+TEST_F(GeneralTests, ApproxDistinct) {
+    auto distinct = streams::generate::counter()
+        .take(100000)
+        .map([](auto&& e) { return e % 20000; })
+        .approxDistinct(14);
+
+    ASSERT_NEAR(20000.0, static_cast<double>(distinct), 20000 * 0.03);
+    ASSERT_NEAR(100.0, static_cast<double>(getStream().approxDistinct()), 3.0);
+}
+
+TEST_F(GeneralTests, ApproxDistinctMerge) {
+    auto left = streams::generate::counter(0).take(30000).sketch(streams::sketch::HyperLogLog(14));
+    auto right = streams::generate::counter(20000).take(30000).sketch(streams::sketch::HyperLogLog(14));
+    left.merge(right);
+
+    ASSERT_NEAR(50000.0, left.estimate(), 50000 * 0.03);
+}
+
+TEST_F(GeneralTests, ApproxQuantiles) {
+    auto q = streams::generate::counter()
+        .take(100000)
+        .approxQuantiles({ 0.0, 0.5, 0.99, 1.0 });
+
+    ASSERT_EQ(4u, q.size());
+    ASSERT_EQ(0u, q[0]);
+    ASSERT_NEAR(50000.0, static_cast<double>(q[1]), 100000 * 0.02);
+    ASSERT_NEAR(99000.0, static_cast<double>(q[2]), 100000 * 0.02);
+    ASSERT_EQ(99999u, q[3]);
+
+    vector.clear();
+    ASSERT_EQ(std::vector<int>{}, getStream().approxQuantiles({ 0.5 }));
+}
+
+TEST_F(GeneralTests, ApproxQuantilesMerge) {
+    using Sketch = streams::sketch::Quantiles<size_t>;
+    auto left = streams::generate::counter(0).take(50000).sketch(Sketch());
+    auto right = streams::generate::counter(50000).take(50000).sketch(Sketch());
+    left.merge(right);
+
+    ASSERT_EQ(100000u, left.count());
+    ASSERT_NEAR(25000.0, static_cast<double>(left.quantile(0.25)), 100000 * 0.02);
+    ASSERT_NEAR(75000.0, static_cast<double>(left.quantile(0.75)), 100000 * 0.02);
+}
+
+TEST_F(GeneralTests, Sample) {
+    auto s = getStream().sample(10, 42);
+    ASSERT_EQ(10u, s.size());
+    for (int e : s) {
+        ASSERT_EQ(1, std::count(s.begin(), s.end(), e));
+        ASSERT_TRUE(e >= 0 && e < 100);
+    }
+    ASSERT_EQ(s, getStream().sample(10, 42));
+
+    auto all = getStream().sample(1000);
+    ASSERT_EQ(vector, all);
+}
+
+TEST_F(GeneralTests, SampleUniform) {
+    std::vector<size_t> hits(10, 0);
+    for (uint64_t seed = 0; seed < 2000; ++seed) {
+        for (size_t e : streams::generate::counter().take(1000).sample(5, seed)) {
+            ++hits[e / 100];
+        }
+    }
+    for (size_t h : hits) {
+        ASSERT_NEAR(1000.0, static_cast<double>(h), 150.0);
+    }
+}
+
+
+
+TEST_F(GeneralTests, SampleMerge) {
+    using Reservoir = streams::sketch::Reservoir<size_t>;
+    auto left = streams::generate::counter(0).take(3).sketch(Reservoir(8, 1));
+    auto right = streams::generate::counter(100).take(50).sketch(Reservoir(8, 2));
+    left.merge(right);
+
+    ASSERT_EQ(8u, left.items.size());
+    ASSERT_EQ(53u, left.seen);
+    std::sort(left.items.begin(), left.items.end());
+    ASSERT_EQ(left.items.end(), std::adjacent_find(left.items.begin(), left.items.end()));
+}
+
+
+
+TEST_F(GeneralTests, Summarize) {
+    auto s = getStream().summarize();
+
+    ASSERT_EQ(100u, s.count);
+    ASSERT_DOUBLE_EQ(4950.0, s.sum());
+    ASSERT_DOUBLE_EQ(49.5, s.mean);
+    ASSERT_DOUBLE_EQ(833.25, s.variance());
+    ASSERT_DOUBLE_EQ(841.6666666666666, s.sampleVariance());
+    ASSERT_EQ(0, s.min);
+    ASSERT_EQ(99, s.max);
+}
+
+TEST_F(GeneralTests, SummarizeEmpty) {
+    vector.clear();
+    auto s = getStream().summarize();
+
+    ASSERT_EQ(0u, s.count);
+    ASSERT_EQ(0.0, s.sum());
+    ASSERT_EQ(0.0, s.variance());
+}
+
+TEST_F(GeneralTests, SummarizeCompensated) {
+    std::vector<double> v(10001, 0.1);
+    v[0] = 1e16;
+    auto s = streams::from(v).summarize();
+
+    ASSERT_EQ(1e16 + 1000.0, s.sum());
+    ASSERT_EQ(0.1, s.min);
+    ASSERT_EQ(1e16, s.max);
+}
+
+TEST_F(GeneralTests, SummarizeMerge) {
+    auto whole = getStream().summarize();
+    auto left = getStream().take(37).summarize();
+    auto right = getStream().skip(37).summarize();
+    left.merge(right);
+
+    ASSERT_EQ(whole.count, left.count);
+    ASSERT_DOUBLE_EQ(whole.sum(), left.sum());
+    ASSERT_DOUBLE_EQ(whole.mean, left.mean);
+    ASSERT_DOUBLE_EQ(whole.variance(), left.variance());
+    ASSERT_EQ(whole.min, left.min);
+    ASSERT_EQ(whole.max, left.max);
+}
+
+
+
+TEST_F(GeneralTests, Fanout) {
+    namespace c = streams::collectors;
+    auto decider = [](auto&& e) { return e % 2; };
+
+    auto results = getStream().fanout(
+        c::count(),
+        c::fold(0, std::plus<int>{}),
+        c::min(),
+        c::max(),
+        c::collect<std::list>(),
+        c::partition(decider));
+
+    ASSERT_EQ(getStream().count(), std::get<0>(results));
+    ASSERT_EQ(getStream().fold(0, std::plus<int>{}), std::get<1>(results));
+    ASSERT_EQ(getStream().min(), std::get<2>(results));
+    ASSERT_EQ(getStream().max(), std::get<3>(results));
+    ASSERT_EQ(getStream().collect<std::list>(), std::get<4>(results));
+    ASSERT_EQ(getStream().partition(decider), std::get<5>(results));
+}
+
+TEST_F(GeneralTests, FanoutShortCircuit) {
+    namespace c = streams::collectors;
+    size_t pulled = 0;
+    auto s = getStream().inspect([&pulled](auto&) { ++pulled; });
+
+    auto results = s.fanout(
+        c::any([](auto& e) { return e == 10; }),
+        c::all([](auto& e) { return e < 5; }),
+        c::find([](auto& e) { return e > 20; }));
+
+    ASSERT_EQ(true, std::get<0>(results));
+    ASSERT_EQ(false, std::get<1>(results));
+    ASSERT_EQ(21, *std::get<2>(results));
+    ASSERT_EQ(22u, pulled); // every collector retired at element 21
+    ASSERT_EQ(22, *s.next());
+}
+
+TEST_F(GeneralTests, FanoutOnEmpty) {
+    namespace c = streams::collectors;
+    vector.clear();
+
+    auto results = getStream().fanout(c::count(), c::any([](auto&) { return true; }), c::all([](auto&) { return false; }), c::min());
+
+    ASSERT_EQ(0u, std::get<0>(results));
+    ASSERT_EQ(false, std::get<1>(results));
+    ASSERT_EQ(true, std::get<2>(results));
+    ASSERT_EQ(false, static_cast<bool>(std::get<3>(results)));
+}
+
+
+
+struct Event {
+    long ts;
+    int value;
+};
+
+TEST_F(GeneralTests, WindowByTimeTumbling) {
+    std::vector<Event> events{ { 0, 1 }, { 3, 2 }, { 9, 3 }, { 10, 4 }, { 15, 5 }, { 42, 6 } };
+
+    auto windows = streams::from(events)
+        .windowByTime([](auto& e) { return e.ts; }, 10, 10, streams::aggregators::sum([](auto& e) { return e.value; }))
+        .collect();
+
+    std::vector<streams::Window<long, int>> check{ { 0, 10, 6 }, { 10, 20, 9 }, { 40, 50, 6 } };
+    ASSERT_EQ(check, windows);
+}
+
+TEST_F(GeneralTests, WindowByTimeSliding) {
+    std::vector<Event> events{ { 0, 5 }, { 1, 3 }, { 2, 4 }, { 3, 1 }, { 4, 9 } };
+    auto ts = [](auto& e) { return e.ts; };
+    auto value = [](auto& e) { return e.value; };
+
+    auto mins = streams::from(events).windowByTime(ts, 3, 1, streams::aggregators::min(value)).collect();
+    auto maxs = streams::from(events).windowByTime(ts, 3, 1, streams::aggregators::max(value)).collect();
+    auto counts = streams::from(events).windowByTime(ts, 3, 1).collect();
+
+    std::vector<streams::Window<long, int>> checkMin{ { -2, 1, 5 }, { -1, 2, 3 }, { 0, 3, 3 }, { 1, 4, 1 }, { 2, 5, 1 }, { 3, 6, 1 }, { 4, 7, 9 } };
+    std::vector<streams::Window<long, int>> checkMax{ { -2, 1, 5 }, { -1, 2, 5 }, { 0, 3, 5 }, { 1, 4, 4 }, { 2, 5, 9 }, { 3, 6, 9 }, { 4, 7, 9 } };
+    std::vector<streams::Window<long, size_t>> checkCount{ { -2, 1, 1 }, { -1, 2, 2 }, { 0, 3, 3 }, { 1, 4, 3 }, { 2, 5, 3 }, { 3, 6, 2 }, { 4, 7, 1 } };
+    ASSERT_EQ(checkMin, mins);
+    ASSERT_EQ(checkMax, maxs);
+    ASSERT_EQ(checkCount, counts);
+}
+
+TEST_F(GeneralTests, WindowByTimeHopping) {
+    auto windows = getStream()
+        .windowByTime([](auto& e) { return e; }, 2, 10, streams::aggregators::mean())
+        .take(3)
+        .collect();
+
+    std::vector<streams::Window<int, double>> check{ { 0, 2, 0.5 }, { 10, 12, 10.5 }, { 20, 22, 20.5 } };
+    ASSERT_EQ(check, windows);
+
+    vector.clear();
+    ASSERT_EQ(0u, getStream().windowByTime([](auto& e) { return e; }, 2, 1).count());
+}
+
+TEST_F(GeneralTests, WindowByTimeUnsigned) {
+    std::vector<size_t> stamps{ 1, 3, 7, 12, 18 };
+    auto counts = streams::from(stamps).windowByTime([](size_t e) { return e; }, size_t(10), size_t(5)).collect();
+    // no window starts before 0, so the ones that would are left out rather than wrapped
+    std::vector<streams::Window<size_t, size_t>> check{ { 0, 10, 3 }, { 5, 15, 2 }, { 10, 20, 2 }, { 15, 25, 1 } };
+    ASSERT_EQ(check, counts);
+
+    std::vector<long> signedStamps{ 1, 3, 7, 12, 18 };
+    auto signedCounts = streams::from(signedStamps).windowByTime([](long e) { return e; }, 10L, 5L).collect();
+    std::vector<streams::Window<long, size_t>> checkSigned{ { -5, 5, 2 }, { 0, 10, 3 }, { 5, 15, 2 }, { 10, 20, 2 }, { 15, 25, 1 } };
+    ASSERT_EQ(checkSigned, signedCounts);
+
+    std::vector<double> fractional{ 0.5, 2.25, 2.75 };
+    auto doubleCounts = streams::from(fractional).windowByTime([](double e) { return e; }, 1.0, 0.5).collect();
+    std::vector<streams::Window<double, size_t>> checkDouble{ { 0.0, 1.0, 1 }, { 0.5, 1.5, 1 }, { 1.5, 2.5, 1 }, { 2.0, 3.0, 2 }, { 2.5, 3.5, 1 } };
+    ASSERT_EQ(checkDouble, doubleCounts);
+}
+
+
+
+TEST_F(GeneralTests, GeneratorRange) {
+    std::vector<int> check{ 3, 5, 7, 9 };
+    ASSERT_EQ(check, streams::generate::range(3, 10, 2).collect());
+
+    std::vector<int> down{ 10, 7, 4, 1 };
+    ASSERT_EQ(down, streams::generate::range(10, 0, -3).collect());
+
+    std::vector<double> halves{ 0.0, 0.5, 1.0, 1.5 };
+    ASSERT_EQ(halves, streams::generate::range(0, 2.0, 0.5).collect());
+
+    ASSERT_EQ(0u, streams::generate::range(5, 5).count());
+    ASSERT_EQ(0u, streams::generate::range(5, 1).count());
+}
+
+TEST_F(GeneralTests, GeneratorRangeRandomAccess) {
+    auto s = streams::generate::range(0L, 1000000000000L, 3L);
+    static_assert(streams::traits::IsRandomAccess<decltype(s.extractor)>::value, "range should be random-access");
+
+    ASSERT_EQ(333333333334u, s.extractor.remaining());
+    ASSERT_EQ(3000000000L, *s.nth(1000000000));
+    ASSERT_EQ(3000000003L, *s.next());
+    ASSERT_EQ(333333333334u - 1000000002u, s.extractor.remaining());
+}
+
+TEST_F(GeneralTests, RandomAccessPropagates) {
+    auto s = getStream().skip(10).map([](auto& e) { return e * 2; }).enumerate().take(50);
+    static_assert(streams::traits::IsRandomAccess<decltype(s.extractor)>::value, "skip, map, enumerate and take keep random access");
+    ASSERT_EQ(50u, s.extractor.remaining());
+
+    auto e = s.nth(20);
+    ASSERT_EQ(20u, e->i);
+    ASSERT_EQ(60, e->v);
+    ASSERT_EQ(29u, s.extractor.remaining());
+
+    auto counted = streams::generate::counter(7).take(100);
+    ASSERT_EQ(100u, counted.extractor.remaining());
+    ASSERT_EQ(57u, *counted.nth(50));
+
+    auto filtered = getStream().filter([](auto&) { return true; });
+    static_assert(!streams::traits::IsRandomAccess<decltype(filtered.extractor)>::value, "filter can't know its size");
+}
+
+TEST_F(GeneralTests, GeneratorIterate) {
+    std::vector<int> check{ 1, 2, 4, 8, 16 };
+    ASSERT_EQ(check, streams::generate::iterate(1, [](int e) { return e * 2; }).take(5).collect());
+}
+
+TEST_F(GeneralTests, GeneratorRepeat) {
+    std::vector<std::string> check(3, "ab");
+    ASSERT_EQ(check, streams::generate::repeat(std::string("ab")).take(3).collect());
+}
+
+TEST_F(GeneralTests, GeneratorPhilox) {
+    // known answer from the Random123 test vectors: Philox4x32-10, zero counter and key
+    auto block = streams::PhiloxGenerator::generate({ { 0, 0, 0, 0 } }, { { 0, 0 } });
+    std::array<uint32_t, 4> check{ { 0x6627e8d5, 0xe169c58d, 0xbc57ac4c, 0x9b00dbd8 } };
+    ASSERT_EQ(check, block);
+    ASSERT_EQ(0xe169c58d6627e8d5ULL, *streams::generate::philox(0).next());
+
+    auto sequential = streams::generate::philox(42, 7).take(1001).collect();
+    for (size_t i : { 0, 1, 2, 3, 500, 999, 1000 }) {
+        ASSERT_EQ(sequential[i], *streams::generate::philox(42, 7).nth(i));
+    }
+    auto s = streams::generate::philox(42, 7);
+    s.nth(2);
+    ASSERT_EQ(sequential[4], *s.nth(1));
+    ASSERT_EQ(sequential[5], *s.next());
+
+    ASSERT_NE(sequential, streams::generate::philox(42, 8).take(1001).collect());
+}
+
+
+
+namespace {
+    void putVarint(std::vector<uint8_t>& out, uint64_t v) {
+        while (v >= 0x80) {
+            out.push_back(static_cast<uint8_t>(v | 0x80));
+            v >>= 7;
+        }
+        out.push_back(static_cast<uint8_t>(v));
+    }
+
+    std::vector<uint8_t> packBits(const std::vector<uint64_t>& values, unsigned width) {
+        std::vector<uint8_t> out((values.size() * width + 7) / 8, 0);
+        for (size_t i = 0; i < values.size(); ++i) {
+            for (unsigned bit = 0; bit < width; ++bit) {
+                const size_t at = i * width + bit;
+                out[at / 8] |= static_cast<uint8_t>(((values[i] >> bit) & 1) << (at % 8));
+            }
+        }
+        return out;
+    }
+}
+
+TEST_F(GeneralTests, DecodeVarint) {
+    std::vector<uint64_t> check;
+    std::vector<uint8_t> bytes;
+    for (uint64_t i = 0; i < 1000; ++i) {
+        const uint64_t v = i % 3 == 0 ? i * i * i * 1000003 : i % 100; // runs of one-byte values and long ones
+        check.push_back(v);
+        putVarint(bytes, v);
+    }
+    check.push_back(~uint64_t(0));
+    putVarint(bytes, ~uint64_t(0));
+
+    ASSERT_EQ(check, streams::decode::varint(bytes.data(), bytes.size()).collect());
+    ASSERT_EQ(0u, streams::decode::varint(bytes.data(), 0).count());
+}
+
+TEST_F(GeneralTests, DecodeDeltaZigzag) {
+    std::vector<int64_t> check{ 1000, 1001, 999, 999, -5, 1LL << 40, 7 };
+    std::vector<uint8_t> bytes;
+    int64_t last = 0;
+    for (int64_t v : check) {
+        const int64_t delta = v - last;
+        putVarint(bytes, (static_cast<uint64_t>(delta) << 1) ^ static_cast<uint64_t>(delta >> 63));
+        last = v;
+    }
+
+    ASSERT_EQ(check, streams::decode::deltaZigzag(bytes.data(), bytes.size()).collect());
+}
+
+TEST_F(GeneralTests, DecodeFrameOfReference) {
+    for (unsigned width : { 0u, 1u, 5u, 13u, 33u, 60u, 64u }) {
+        std::vector<uint64_t> offsets;
+        std::vector<int64_t> check;
+        const uint64_t mask = width == 64 ? ~uint64_t(0) : (uint64_t(1) << width) - 1;
+        for (uint64_t i = 0; i < 300; ++i) {
+            offsets.push_back((i * 0x9e3779b97f4a7c15ULL) & mask);
+            check.push_back(static_cast<int64_t>(static_cast<uint64_t>(-42) + offsets.back()));
+        }
+        auto bytes = packBits(offsets, width);
+
+        ASSERT_EQ(check, streams::decode::frameOfReference(bytes.data(), offsets.size(), width, -42).collect());
+    }
+}
+
+TEST_F(GeneralTests, DecodeDictionary) {
+    std::vector<streams::StringView> dictionary{ "GET", "POST", "PUT" };
+    std::vector<uint64_t> codes{ 0, 1, 0, 2, 2, 1 };
+    auto bytes = packBits(codes, 2);
+
+    auto res = streams::decode::dictionary(bytes.data(), codes.size(), 2, dictionary)
+        .map([](auto& e) { return std::string(e.data(), e.size()); })
+        .collect();
+
+    std::vector<std::string> check{ "GET", "POST", "GET", "PUT", "PUT", "POST" };
+    ASSERT_EQ(check, res);
+}
+
+TEST_F(GeneralTests, DecodeBlocks) {
+    std::vector<uint8_t> bytes;
+    for (uint64_t i = 0; i < 1000; ++i) {
+        putVarint(bytes, i);
+    }
+
+    auto blocks = streams::decode::blocks(streams::decode::VarintDecoder(bytes.data(), bytes.size()));
+    auto sum = blocks.fold(uint64_t(0), [](uint64_t a, auto& block) { return std::accumulate(block.begin(), block.end(), a); });
+    ASSERT_EQ(999u * 1000 / 2, sum);
+
+    auto flat = streams::decode::blocks(streams::decode::VarintDecoder(bytes.data(), bytes.size())).flatten().count();
+    ASSERT_EQ(1000u, flat);
+}
+
+
+
+TEST_F(GeneralTests, FromColumns) {
+    std::vector<std::string> names{ "a", "b", "c", "d" };
+    std::vector<double> prices{ 1.5, 2.5, 3.5, 4.5, 5.5 };
+
+    auto res = streams::fromColumns(vector, names, prices)
+        .filter([](auto& row) { return row.template get<0>() % 2 == 1; })
+        .map([](auto& row) { return streams::get<1>(row) + std::to_string(row.template get<2>()).substr(0, 3); })
+        .collect();
+
+    std::vector<std::string> check{ "b2.5", "d4.5" };
+    ASSERT_EQ(check, res);
+    ASSERT_EQ(4u, streams::fromColumns(vector, names, prices).count());
+}
+
+TEST_F(GeneralTests, FromColumnsReferences) {
+    auto row = *streams::fromColumns(vector).nth(42);
+    ASSERT_EQ(&vector[42], &row.get<0>());
+
+    auto s = streams::fromColumns(vector, vector);
+    static_assert(streams::traits::IsRandomAccess<decltype(s.extractor)>::value, "columns are random-access");
+    ASSERT_EQ(100u, s.extractor.remaining());
+}
+
+TEST_F(GeneralTests, FromColumnsProject) {
+    std::vector<std::string> names(100, "x");
+    std::vector<long> squares;
+    for (long i = 0; i < 100; ++i) {
+        squares.push_back(i * i);
+    }
+
+    auto s = streams::fromColumns(vector, names, squares);
+    s.nth(9);
+    auto projected = s.project<2, 0>();
+    static_assert(sizeof(projected.extractor.row) < sizeof(s.extractor.row), "projected rows are smaller");
+
+    auto row = *projected.next();
+    ASSERT_EQ(100, row.get<0>());
+    ASSERT_EQ(10, row.get<1>());
+    ASSERT_EQ(89u, projected.count());
+}
+
+
+
+TEST_F(GeneralTests, ZipVariadic) {
+    std::vector<std::string> names{ "a", "b", "c" };
+    std::vector<double> prices{ 1.5, 2.5, 3.5, 4.5 };
+
+    auto res = streams::zip(getStream(), streams::from(names), streams::from(prices), streams::generate::counter(10)).collect();
+
+    using Row = std::tuple<int, std::string, double, size_t>;
+    std::vector<Row> check{ Row{ 0, "a", 1.5, 10 }, Row{ 1, "b", 2.5, 11 }, Row{ 2, "c", 3.5, 12 } };
+    ASSERT_EQ(check, res);
+
+    auto s = streams::zip(getStream(), getStream().skip(10));
+    ASSERT_EQ(90u, s.extractor.remaining());
+    ASSERT_EQ(std::make_tuple(50, 60), *s.nth(50));
+}
+
+TEST_F(GeneralTests, ChainVariadic) {
+    std::vector<int> a{ 1, 2 };
+    std::vector<int> b{};
+    std::vector<int> c{ 3 };
+    std::list<int> d{ 4, 5 };
+
+    auto res = streams::chain(streams::from(a), streams::from(b), streams::from(c), streams::from(d),
+                              getStream().map([](auto& e) { return e + 6; }).take(2))
+        .collect();
+
+    std::vector<int> check{ 1, 2, 3, 4, 5, 6, 7 };
+    ASSERT_EQ(check, res);
+}
+
+TEST_F(GeneralTests, ChainVariadicRandomAccess) {
+    std::vector<int> a{ 1, 2, 3 };
+    std::vector<int> b{};
+    std::vector<int> c{ 4, 5, 6, 7 };
+
+    auto s = streams::chain(streams::from(a), streams::from(b), streams::from(c));
+    ASSERT_EQ(7u, s.extractor.remaining());
+    ASSERT_EQ(2, *s.nth(1));
+    ASSERT_EQ(5, *s.nth(2));
+    ASSERT_EQ(2u, s.extractor.remaining());
+    ASSERT_EQ(7, *s.last());
+    ASSERT_EQ(false, static_cast<bool>(s.next()));
+}
+
+
+
+TEST_F(GeneralTests, CopyTo) {
+    std::vector<int> vec;
+    auto it = getStream().filter([](auto& e) { return e < 10; }).copyTo(std::back_inserter(vec));
+    *it = 42;
+
+    std::vector<int> check{ 0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 42 };
+    ASSERT_EQ(check, vec);
+}
+
+#if defined __unix__ || defined __APPLE__
+namespace {
+    std::string readAll(int fd) {
+        std::string content;
+        char chunk[4096];
+        ::lseek(fd, 0, SEEK_SET);
+        for (ssize_t n; (n = ::read(fd, chunk, sizeof(chunk))) > 0;) {
+            content.append(chunk, static_cast<size_t>(n));
+        }
+        return content;
+    }
+
+    struct TemporaryFile {
+        char path[32] = "/tmp/streams-XXXXXX";
+        int fd = ::mkstemp(path);
+
+        ~TemporaryFile() {
+            ::close(fd);
+            ::unlink(path);
+        }
+    };
+}
+
+TEST_F(GeneralTests, WriteLines) {
+    std::vector<double> doubles{ 0.1, -2.5, 1e300, 3 };
+    std::vector<std::string> strings{ "abc", "", "de" };
+    std::vector<long long> integers{ 0, -1, std::numeric_limits<long long>::min(), std::numeric_limits<long long>::max() };
+
+    TemporaryFile file;
+    ASSERT_TRUE(streams::from(doubles).writeLines(file.fd));
+    ASSERT_TRUE(streams::from(strings).writeLines(file.fd));
+    ASSERT_TRUE(streams::from(integers).writeLines(file.fd));
+    ASSERT_TRUE(getStream().take(3).enumerate().writeLines(file.fd)); // through operator <<
+
+    ASSERT_EQ("0.1\n-2.5\n1e+300\n3\nabc\n\nde\n0\n-1\n-9223372036854775808\n9223372036854775807\n(0, 0)\n(1, 1)\n(2, 2)\n", readAll(file.fd));
+    ASSERT_FALSE(getStream().writeLines(-1));
+
+    // shortest for the element's own type, not for the double it widens to
+    std::vector<float> floats{ 0.1f, 1.0f / 3, -2.5f };
+    std::vector<long double> longDoubles{ 0.1L, 1.0L / 3 };
+    TemporaryFile narrow;
+    ASSERT_TRUE(streams::from(floats).writeLines(narrow.fd));
+    ASSERT_TRUE(streams::from(longDoubles).writeLines(narrow.fd));
+    std::istringstream text(readAll(narrow.fd));
+    std::vector<std::string> lines;
+    for (std::string line; std::getline(text, line);) {
+        lines.push_back(line);
+    }
+    ASSERT_EQ(5u, lines.size());
+    ASSERT_EQ("0.1", lines[0]);
+    ASSERT_EQ("0.33333334", lines[1]);
+    ASSERT_EQ("-2.5", lines[2]);
+    ASSERT_EQ("0.1", lines[3]);
+    ASSERT_EQ(1.0L / 3, std::strtold(lines[4].c_str(), nullptr));
+}
+
+TEST_F(GeneralTests, WriteLinesBuffering) {
+    std::string check;
+    for (size_t i = 0; i < 2000; ++i) {
+        check += std::string(i % 97, 'x') + std::to_string(i) + "\n";
+    }
+    std::string huge(100000, 'y');
+    check += huge + "\n";
+
+    for (bool background : { false, true }) {
+        TemporaryFile file;
+        auto lines = streams::generate::counter()
+            .take(2000)
+            .map([](auto& i) { return std::string(i % 97, 'x') + std::to_string(i); })
+            .chain(streams::generate::repeat(huge).take(1));
+        streams::io::WriteOptions options;
+        options.bufferSize = 1000;
+        options.background = background;
+
+        ASSERT_TRUE(lines.writeLines(file.path, options));
+        ASSERT_EQ(check, readAll(file.fd));
+    }
+}
+
+TEST_F(GeneralTests, WriteBinary) {
+    TemporaryFile file;
+    ASSERT_TRUE(getStream().writeBinary(file.fd));
+
+    auto content = readAll(file.fd);
+    ASSERT_EQ(vector.size() * sizeof(int), content.size());
+    ASSERT_EQ(0, std::memcmp(vector.data(), content.data(), content.size()));
+}
+#endif
+
+
+
+TEST_F(GeneralTests, Pipe) {
+    auto p = streams::pipe()
+        .filter([](auto& e) { return e % 3 == 0; })
+        .map([](auto& e) { return e * 10; })
+        .skip(1)
+        .take(3);
+
+    std::vector<int> check{ 30, 60, 90 };
+    ASSERT_EQ(check, p(getStream()).collect());
+    ASSERT_EQ(check, (vector | p).collect());
+    ASSERT_EQ(check, (getStream() | p).collect());
+
+    std::vector<int> other{ 9, 3, 6, 12, 15 };
+    std::vector<int> checkOther{ 30, 60, 120 };
+    ASSERT_EQ(checkOther, (other | p).collect());
+}
+
+TEST_F(GeneralTests, PipeSharesState) {
+    std::vector<int> lookup(1000, 7);
+    size_t copies = 0;
+    struct Counted {
+        size_t* copies;
+        const std::vector<int>* lookup;
+        Counted(size_t* c, const std::vector<int>* l) : copies(c), lookup(l) {}
+        Counted(const Counted& other) : copies(other.copies), lookup(other.lookup) { ++*copies; }
+        Counted(Counted&&) = default;
+        int operator()(int e) const { return (*lookup)[static_cast<size_t>(e)] + e; }
+    };
+
+    auto p = streams::pipe().map(Counted(&copies, &lookup)).enumerate();
+    copies = 0;
+    for (int i = 0; i < 10; ++i) {
+        ASSERT_EQ(static_cast<size_t>(100), (vector | p).count());
+    }
+    ASSERT_EQ(0u, copies);
+
+    size_t seen = 0;
+    auto counting = streams::pipe().inspect([&seen](auto&) { ++seen; });
+    (vector | counting).count();
+    (vector | counting).count();
+    ASSERT_EQ(200u, seen);
+}
+
+
+
+TEST_F(GeneralTests, MoveOnlyFunctors) {
+    auto offset = std::make_unique<int>(1000);
+    auto limit = std::make_unique<int>(5);
+    auto result = getStream()
+        .map([offset = std::move(offset)](auto& e) { return e + *offset; })
+        .filter([limit = std::move(limit)](auto& e) { return e % *limit == 0; })
+        .take(3)
+        .collect();
+    std::vector<int> check{ 1000, 1005, 1010 };
+    ASSERT_EQ(check, result);
+}
+
+TEST_F(GeneralTests, RvalueChainDoesNotCopy) {
+    size_t copies = 0;
+    struct Counted {
+        size_t* copies;
+        explicit Counted(size_t* c) : copies(c) {}
+        Counted(const Counted& other) : copies(other.copies) { ++*copies; }
+        Counted(Counted&&) = default;
+        bool operator()(int e) const { return e % 2 == 0; }
+    };
+
+    auto stream = getStream()
+        .filter(Counted(&copies))
+        .skip(2)
+        .inspect([](auto&) {})
+        .enumerate()
+        .take(10);
+    ASSERT_EQ(0u, copies);
+    ASSERT_EQ(10u, std::move(stream).count());
+    ASSERT_EQ(0u, copies);
+}
+
+TEST_F(GeneralTests, LvalueStreamStaysUsable) {
+    auto evens = getStream().filter([](auto& e) { return e % 2 == 0; });
+    auto doubled = evens.map([](auto& e) { return e * 2; });
+    ASSERT_EQ(0, *evens.next());
+    ASSERT_EQ(2, *evens.next());
+    ASSERT_EQ(0, *doubled.next());
+    ASSERT_EQ(4, *doubled.next());
+}
+
+
+
+TEST_F(GeneralTests, CompactLayouts) {
+    using Iterator = std::vector<int>::const_iterator;
+    auto source = getStream();
+    const size_t base = sizeof(source.extractor);
+    ASSERT_EQ(2 * sizeof(Iterator), base);
+
+    // stateless functors take no space
+    auto mapped = source.map([](auto& e) { return e * 2; });
+    auto filtered = source.filter([](auto& e) { return e % 2 == 0; });
+    auto inspected = source.inspect([](auto&) {});
+    auto spied = source.spy([](auto&) {});
+    auto stacked = source.filter([](auto& e) { return e % 2 == 0; }).map([](auto& e) { return e * 2; }).inspect([](auto&) {});
+    ASSERT_EQ(base, sizeof(mapped.extractor));
+    ASSERT_EQ(base, sizeof(filtered.extractor));
+    ASSERT_EQ(base, sizeof(inspected.extractor));
+    ASSERT_EQ(base, sizeof(spied.extractor));
+    ASSERT_EQ(base, sizeof(stacked.extractor));
+
+    auto taken = source.take(1);
+    auto skipped = source.skip(1);
+    auto skippedWhile = source.skipWhile([](auto& e) { return e < 5; });
+    auto takenWhile = source.takeWhile([](auto& e) { return e < 5; });
+    ASSERT_EQ(base + sizeof(size_t), sizeof(taken.extractor));
+    ASSERT_EQ(base + sizeof(size_t), sizeof(skipped.extractor));
+    ASSERT_EQ(base + sizeof(size_t), sizeof(skippedWhile.extractor)); // a bool, padded
+    ASSERT_EQ(base + sizeof(size_t), sizeof(takenWhile.extractor));
+
+    // captures are stored, and lvalue functors are referenced
+    const int k = 3;
+    auto times = [k](auto& e) { return e * k; };
+    auto captured = source.map([k](auto& e) { return e * k; });
+    auto referenced = source.map(times);
+    ASSERT_EQ(base + sizeof(size_t), sizeof(captured.extractor));
+    ASSERT_EQ(base + sizeof(&times), sizeof(referenced.extractor));
+}
+
+TEST_F(GeneralTests, ForwardIteratorSource) {
+    std::forward_list<int> list{ 1, 2, 3, 4 };
+    auto stream = streams::from(list);
+    ASSERT_EQ(3 * sizeof(std::forward_list<int>::const_iterator), sizeof(stream.extractor));
+
+    std::vector<int> check{ 2, 4, 6, 8 };
+    ASSERT_EQ(check, stream.map([](auto& e) { return e * 2; }).collect());
+}
+
+TEST_F(GeneralTests, ChainComputedElements) {
+    auto computed = getStream().take(2).map([](auto& e) { return e + 100; });
+    std::vector<int> check{ 100, 101, 0, 1, 100, 101 };
+    ASSERT_EQ(check, computed.chain(getStream().take(2)).chain(computed).collect());
+    ASSERT_EQ(check, streams::chain(computed, getStream().take(2), computed).collect());
+
+    auto last = computed.last();
+    ASSERT_EQ(101, *last);
+}
+
+
+
+TEST_F(GeneralTests, TakeFixed) {
+    std::vector<int> check{ 0, 2, 4, 6 };
+    ASSERT_EQ(check, getStream().filter([](auto& e) { return e % 2 == 0; }).take<4>().collect());
+    ASSERT_EQ(0u, getStream().take<0>().count());
+    ASSERT_EQ(100u, getStream().take<1000>().count());
+
+    auto stream = getStream().take<10>();
+    ASSERT_EQ(10u, stream.extractor.remaining());
+    ASSERT_EQ(7, *stream.nth(7));
+    ASSERT_EQ(2u, stream.extractor.remaining());
+}
+
+TEST_F(GeneralTests, CollectFixed) {
+    auto small = getStream().filter([](auto& e) { return e % 10 == 0; }).collect<16>();
+    static_assert(std::is_same<decltype(small), streams::FixedVector<int, 16>>::value, "inline storage");
+    std::vector<int> check{ 0, 10, 20, 30, 40, 50, 60, 70, 80, 90 };
+    ASSERT_EQ(check, std::vector<int>(small.begin(), small.end()));
+    ASSERT_FALSE(small.full());
+
+    auto stream = getStream();
+    auto first = stream.collect<4>();
+    std::vector<int> checkFirst{ 0, 1, 2, 3 };
+    ASSERT_EQ(checkFirst, std::vector<int>(first.begin(), first.end()));
+    ASSERT_TRUE(first.full());
+    ASSERT_FALSE(first.push_back(4));
+    ASSERT_EQ(4, *stream.next()); // truncated: the rest is still there
+
+    vector.clear();
+    ASSERT_TRUE(getStream().collect<4>().empty());
+}
+
+
+
+TEST_F(GeneralTests, SampleBernoulli) {
+    ASSERT_EQ(100u, getStream().sampleBernoulli(1.0).count());
+    ASSERT_EQ(0u, getStream().sampleBernoulli(0.0).count());
+
+    auto sampled = getStream().sampleBernoulli(0.3, 7).collect();
+    ASSERT_TRUE(std::is_sorted(sampled.begin(), sampled.end()));
+    ASSERT_EQ(sampled, getStream().sampleBernoulli(0.3, 7).collect());
+    ASSERT_NE(sampled, getStream().sampleBernoulli(0.3, 8).collect());
+
+    std::vector<int> large(1000000);
+    std::iota(large.begin(), large.end(), 0);
+    const size_t kept = streams::from(large).sampleBernoulli(0.01, 1).count();
+    ASSERT_NEAR(10000.0, static_cast<double>(kept), 500.0);
+}
+
+TEST_F(GeneralTests, SampleBernoulliJumps) {
+    std::vector<int> large(1000000);
+    size_t visited = 0;
+    const size_t kept = streams::from(large)
+        .spy([&visited](auto&) { ++visited; })
+        .sampleBernoulli(0.001, 3)
+        .count();
+    ASSERT_GT(kept, 0u);
+    ASSERT_EQ(0u, visited); // count() never reads an element, and skipped ones are never touched
+
+    size_t inspected = 0;
+    streams::from(large)
+        .inspect([&inspected](auto&) { ++inspected; })
+        .sampleBernoulli(0.001, 3)
+        .count();
+    ASSERT_EQ(large.size(), inspected); // inspect is not random-access, so everything is pulled
+}
+
+
+
+TEST_F(GeneralTests, PartitionBy) {
+    auto buckets = getStream().partitionBy(7, [](auto& e) { return static_cast<size_t>(e % 7); });
+    ASSERT_EQ(7u, buckets.size());
+    for (size_t b = 0; b != buckets.size(); ++b) {
+        std::vector<int> check;
+        std::copy_if(vector.begin(), vector.end(), std::back_inserter(check), [b](int e) { return static_cast<size_t>(e % 7) == b; });
+        ASSERT_EQ(check, buckets[b]);
+        ASSERT_EQ(check.size(), buckets[b].capacity()); // sized by the histogram pass
+    }
+}
+
+TEST_F(GeneralTests, PartitionBySinglePass) {
+    size_t calls = 0;
+    auto buckets = getStream()
+        .filter([](auto& e) { return e % 2 == 0; })
+        .partitionBy(64, [&calls](auto& e) { ++calls; return static_cast<size_t>(e) % 64; });
+    ASSERT_EQ(50u, calls);
+    ASSERT_EQ(64u, buckets.size());
+
+    size_t mapped = 0;
+    auto halves = getStream()
+        .map([&mapped](auto& e) { ++mapped; return e; })
+        .partitionBy(2, [](auto& e) { return static_cast<size_t>(e) % 2; });
+    ASSERT_EQ(100u, mapped); // a random-access chain with stages is still walked once
+    ASSERT_EQ(50u, halves[1].size());
+    std::vector<int> check{ 0, 64 };
+    ASSERT_EQ(check, buckets[0]);
+    ASSERT_TRUE(buckets[1].empty());
+    ASSERT_EQ(std::vector<int>{ 62 }, buckets[62]);
+
+    std::vector<std::string> words{ "a", "bb", "cc", "ddd", "e" };
+    auto byLength = streams::from(words).partitionBy(4, [](auto& w) { return w.size(); });
+    std::vector<std::string> checkOne{ "a", "e" };
+    ASSERT_EQ(checkOne, byLength[1]);
+    ASSERT_EQ(2u, byLength[2].size());
+    ASSERT_TRUE(byLength[0].empty());
+}
+
+
+
+TEST_F(GeneralTests, Channel) {
+    streams::Channel<int> channel(3);
+    ASSERT_EQ(4u, channel.cells.size());
+    for (int i = 0; i < 4; ++i) {
+        ASSERT_TRUE(channel.trySend(i));
+    }
+    ASSERT_FALSE(channel.trySend(4));
+
+    int value = -1;
+    ASSERT_TRUE(channel.tryReceive(value));
+    ASSERT_EQ(0, value);
+    ASSERT_TRUE(channel.trySend(4));
+
+    channel.close();
+    ASSERT_FALSE(channel.send(5));
+    std::vector<int> check{ 1, 2, 3, 4 };
+    ASSERT_EQ(check, channel.stream().collect()); // drained after close
+    ASSERT_FALSE(channel.receive());
+}
+
+TEST_F(GeneralTests, ChannelProducersConsumers) {
+    streams::Channel<int> channel(16);
+    const int producers = 4;
+    const int consumers = 3;
+
+    std::vector<long> sums(consumers, 0);
+    std::vector<size_t> counts(consumers, 0);
+    std::vector<std::thread> readers;
+    for (int c = 0; c < consumers; ++c) {
+        readers.emplace_back([&, c] {
+            channel.stream().forEach([&](int e) { sums[c] += e; ++counts[c]; });
+        });
+    }
+
+    std::vector<std::thread> writers;
+    for (int p = 0; p < producers; ++p) {
+        writers.emplace_back([&] { ASSERT_EQ(vector.size(), getStream().sendTo(channel)); });
+    }
+    for (auto& writer : writers) {
+        writer.join();
+    }
+    channel.close();
+    for (auto& reader : readers) {
+        reader.join();
+    }
+
+    ASSERT_EQ(producers * vector.size(), std::accumulate(counts.begin(), counts.end(), size_t{ 0 }));
+    ASSERT_EQ(producers * 4950L, std::accumulate(sums.begin(), sums.end(), 0L));
+}
+
+
+#if defined __unix__ || defined __APPLE__
+TEST_F(GeneralTests, ReadLines) {
+    std::vector<std::string> check;
+    std::string content;
+    for (int i = 0; i < 5000; ++i) {
+        check.push_back(std::string(static_cast<size_t>(i % 97), 'a' + static_cast<char>(i % 26)) + std::to_string(i));
+        content += check.back() + '\n';
+    }
+    check.push_back("last, without a newline");
+    content += check.back();
+
+    TemporaryFile file;
+    ASSERT_EQ(static_cast<ssize_t>(content.size()), ::write(file.fd, content.data(), content.size()));
+
+    for (bool uring : { true, false }) {
+        for (bool direct : { false, true }) {
+            streams::io::ReadOptions options;
+            options.chunkSize = 4096; // lines span chunks
+            options.queueDepth = 3;
+            options.uring = uring;
+            options.direct = direct;
+            auto lines = streams::io::lines(file.path, options).map([](auto& line) { return std::string(line.data(), line.size()); }).collect();
+            ASSERT_EQ(check, lines);
+        }
+    }
+}
+
+TEST_F(GeneralTests, ReadRecords) {
+    TemporaryFile file;
+    const std::string content = "a,,bc,";
+    ASSERT_EQ(static_cast<ssize_t>(content.size()), ::write(file.fd, content.data(), content.size()));
+
+    std::vector<size_t> check{ 1, 0, 2 };
+    ASSERT_EQ(check, streams::io::lines(file.path, {}, ',').map([](auto& record) { return record.size(); }).collect());
+
+    auto missing = streams::io::lines("/nonexistent/streams");
+    ASSERT_TRUE(missing.extractor.reader->failed);
+    ASSERT_EQ(0u, std::move(missing).count());
+
+    TemporaryFile empty;
+    ASSERT_EQ(0u, streams::io::lines(empty.path).count());
+}
+#endif
+
+
+
+namespace {
+    size_t occurrences(const std::string& text, const std::string& pattern) {
+        size_t count = 0;
+        for (size_t at = text.find(pattern); at != std::string::npos; at = text.find(pattern, at + 1)) {
+            ++count;
+        }
+        return count;
+    }
+}
+
+TEST_F(GeneralTests, TraceLabels) {
+    streams::trace::enable();
+    const size_t kept = getStream()
+        .label("source", 30)
+        .filter([](auto& e) { return e % 2 == 0; })
+        .label()
+        .count();
+    streams::trace::disable();
+    ASSERT_EQ(50u, kept);
+
+    const std::string json = streams::trace::json();
+    ASSERT_EQ(0u, json.find("{\"displayTimeUnit\":\"ns\",\"traceEvents\":["));
+    ASSERT_EQ(4u, occurrences(json, "\"name\":\"source\",\"ph\":\"b\"")); // 101 advances in batches of 30
+    ASSERT_EQ(4u, occurrences(json, "\"name\":\"source\",\"ph\":\"e\""));
+#if defined __GNUC__
+    ASSERT_EQ(1u, occurrences(json, "\"name\":\"streams::FilterStreamExtractor\",\"ph\":\"b\""));
+#endif
+
+    streams::trace::enable();
+    streams::trace::disable();
+    ASSERT_EQ(0u, getStream().label("ignored").count() - vector.size());
+    ASSERT_EQ(std::string::npos, streams::trace::json().find("ignored"));
+}
+
+TEST_F(GeneralTests, TraceThreads) {
+    streams::trace::enable(8);
+    streams::Channel<int> channel(4);
+    std::thread producer([&] { getStream().take(3).sendTo(channel); streams::trace::instant("sent \"all\""); });
+    producer.join();
+    channel.close();
+    ASSERT_EQ(3u, channel.stream().count());
+    streams::trace::disable();
+
+    const std::string json = streams::trace::json();
+    ASSERT_EQ(3u, occurrences(json, "\"name\":\"channel depth\",\"ph\":\"C\",\"pid\":1,\"tid\":"));
+    ASSERT_EQ(1u, occurrences(json, "\"args\":{\"value\":3}")); // nothing received while sending
+    ASSERT_EQ(1u, occurrences(json, "\"name\":\"sent \\\"all\\\"\",\"ph\":\"i\""));
+
+#if defined __unix__ || defined __APPLE__
+    TemporaryFile file;
+    ASSERT_TRUE(streams::trace::save(file.path));
+    ASSERT_EQ(json, readAll(file.fd));
+#endif
+}
+
+
+
+TEST_F(GeneralTests, ParallelFind) {
+    std::vector<int> large(1000000);
+    std::iota(large.begin(), large.end(), 0);
+    const auto late = [](auto& e) { return e % 100000 == 99999; };
+
+    for (size_t threads : { 1, 3, 8 }) {
+        ASSERT_EQ(99999, *streams::from(large).parallelFind(late, threads));
+        ASSERT_EQ(100000u, *streams::from(large).parallelPosition(late, threads));
+        ASSERT_FALSE(streams::from(large).parallelFind([](auto& e) { return e < 0; }, threads));
+        ASSERT_FALSE(streams::from(large).parallelPosition([](auto& e) { return e < 0; }, threads));
+
+        auto any = streams::from(large).findAny(late, threads);
+        ASSERT_TRUE(any && late(*any));
+    }
+
+    std::atomic<size_t> calls { 0 };
+    ASSERT_EQ(5000, *streams::from(large).parallelFind([&calls](auto& e) { ++calls; return e == 5000; }, 1));
+    ASSERT_EQ(5001u, calls.load()); // later ranges are abandoned
+
+    const auto failing = [](auto& e) { if (e == 500000) throw std::runtime_error("predicate"); return false; };
+    ASSERT_THROW(streams::from(large).parallelFind(failing, 4), std::runtime_error);
+    ASSERT_THROW(streams::from(large).findAny(failing, 4), std::runtime_error);
+    ASSERT_THROW(streams::from(large)
+        .map([](auto& e) { if (e == 700000) throw std::runtime_error("map"); return e; })
+        .parallelPosition([](auto&) { return false; }, 4), std::runtime_error);
+
+    auto stream = streams::from(large).map([](auto& e) { return e * 2; });
+    ASSERT_EQ(2000, *stream.parallelFind([](auto& e) { return e >= 2000; }));
+    ASSERT_EQ(2002, *stream.next()); // left after the element found
+}
+
+TEST_F(GeneralTests, ParallelAnyAll) {
+    std::vector<int> large(500000, 1);
+    large[400000] = 2;
+    ASSERT_TRUE(streams::from(large).parallelAny([](auto& e) { return e == 2; }));
+    ASSERT_FALSE(streams::from(large).parallelAll([](auto& e) { return e == 1; }));
+    ASSERT_TRUE(streams::from(large).parallelAll([](auto& e) { return e > 0; }, 4));
+    ASSERT_FALSE(streams::from(large).parallelAny([](auto& e) { return e > 2; }, 4));
+
+    vector.clear();
+    ASSERT_FALSE(getStream().parallelAny([](auto&) { return true; }));
+    ASSERT_TRUE(getStream().parallelAll([](auto&) { return false; }));
+}
+
+
+
+TEST_F(GeneralTests, Scan) {
+    std::vector<long> check;
+    std::partial_sum(vector.begin(), vector.end(), std::back_inserter(check));
+    const auto plus = [](long acc, int e) { return acc + e; };
+    ASSERT_EQ(check, getStream().scan(0L, plus).collect());
+
+    check.insert(check.begin(), 0);
+    check.pop_back();
+    ASSERT_EQ(check, getStream().scanExclusive(0L, plus).collect());
+
+    std::vector<int> values{ 3, 1, 4, 1, 5, 9, 2, 6 };
+    std::vector<int> runningMax{ 3, 3, 4, 4, 5, 9, 9, 9 };
+    ASSERT_EQ(runningMax, streams::from(values).scan(std::numeric_limits<int>::min(), [](int acc, int e) { return std::max(acc, e); }).collect());
+
+    auto words = streams::from(values).take(3).scan(std::string(), [](std::string acc, int e) { return acc + std::to_string(e); }).collect();
+    std::vector<std::string> checkWords{ "3", "31", "314" };
+    ASSERT_EQ(checkWords, words);
+
+    vector.clear();
+    ASSERT_EQ(0u, getStream().scan(0, plus).count());
+}
+
+TEST_F(GeneralTests, ParallelScan) {
+    std::vector<int> large(300001);
+    std::iota(large.begin(), large.end(), -1000);
+    const auto plus = [](long long acc, long long e) { return acc + e; };
+
+    std::vector<long long> check(large.begin(), large.end());
+    std::partial_sum(check.begin(), check.end(), check.begin());
+    for (auto& c : check) {
+        c += 7;
+    }
+
+    for (size_t threads : { 1, 2, 7 }) {
+        auto stream = streams::from(large);
+        ASSERT_EQ(check, stream.parallelScan(7LL, plus, threads));
+        ASSERT_FALSE(stream.next());
+        ASSERT_EQ(check, streams::from(large).scan(7LL, plus).collect());
+
+        auto exclusive = streams::from(large).parallelScan(7LL, plus, threads, false);
+        ASSERT_EQ(7, exclusive[0]);
+        ASSERT_TRUE(std::equal(check.begin(), check.end() - 1, exclusive.begin() + 1));
+    }
+
+    std::vector<bool> seen(large.size(), false);
+    std::fill(seen.begin() + 150000, seen.end(), true);
+    auto any = streams::from(large).map([](int e) { return e == 149000; }).parallelScan(false, [](bool acc, bool e) { return acc || e; }, 4);
+    ASSERT_EQ(seen, any);
+
+    const auto failing = [](long long acc, long long e) { if (e == 250000) throw std::runtime_error("op"); return acc + e; };
+    ASSERT_THROW(streams::from(large).parallelScan(0LL, failing, 4), std::runtime_error);
+
+    vector.clear();
+    ASSERT_TRUE(getStream().parallelScan(0, plus).empty());
+}
+
+
+
+TEST_F(GeneralTests, Sorted) {
+    std::vector<int> shuffled = vector;
+    std::reverse(shuffled.begin(), shuffled.end());
+    ASSERT_EQ(vector, streams::from(shuffled).sorted().collect());
+
+    std::vector<int> descending = shuffled;
+    ASSERT_EQ(descending, getStream().sorted(std::greater<int>()).collect());
+
+    std::vector<int> mixed{ 5, -3, 0, std::numeric_limits<int>::min(), 7, -3, std::numeric_limits<int>::max() };
+    std::vector<int> checkMixed = mixed;
+    std::sort(checkMixed.begin(), checkMixed.end());
+    ASSERT_EQ(checkMixed, streams::from(mixed).sorted().collect());
+
+    std::vector<double> doubles{ 2.5, -0.5, 1e300, -1e300, 0.0, -7.25, 3.0 };
+    std::vector<double> checkDoubles = doubles;
+    std::sort(checkDoubles.begin(), checkDoubles.end());
+    ASSERT_EQ(checkDoubles, streams::from(doubles).sorted().collect());
+
+    std::vector<double> zeros{ 0.0, -0.0, 1.0, 0.0, -0.0 }; // equal under std::less, so kept in order
+    auto sortedZeros = streams::from(zeros).sorted().collect();
+    std::vector<bool> signs;
+    for (double e : sortedZeros) {
+        signs.push_back(std::signbit(e));
+    }
+    std::vector<bool> checkSigns{ false, true, false, true, false };
+    ASSERT_EQ(checkSigns, signs);
+    std::vector<float> floatZeros{ -0.0f, 0.0f, -1.0f };
+    auto sortedFloatZeros = streams::from(floatZeros).sortedBy([](float e) { return e; }).collect();
+    ASSERT_EQ(-1.0f, sortedFloatZeros[0]);
+    ASSERT_TRUE(std::signbit(sortedFloatZeros[1]));
+    ASSERT_FALSE(std::signbit(sortedFloatZeros[2]));
+
+    std::vector<long double> longDoubles{ 2.5L, -1.0L, 0.5L };
+    std::vector<long double> checkLongDoubles{ -1.0L, 0.5L, 2.5L };
+    ASSERT_EQ(checkLongDoubles, streams::from(longDoubles).sorted().collect());
+    ASSERT_EQ(checkLongDoubles, streams::from(longDoubles).sortedBy([](long double e) { return e; }).collect());
+
+    std::vector<std::string> words{ "pear", "fig", "apple", "kiwi", "banana" };
+    std::vector<std::string> byLength{ "fig", "pear", "kiwi", "apple", "banana" }; // stable
+    ASSERT_EQ(byLength, streams::from(words).sortedBy([](auto& w) { return w.size(); }).collect());
+    std::vector<std::string> byName{ "apple", "banana", "fig", "kiwi", "pear" };
+    ASSERT_EQ(byName, streams::from(words).sorted().collect());
+    ASSERT_EQ(byName, streams::from(words).sortedBy([](auto& w) { return w; }).collect());
+
+    auto top = getStream().filter([](auto& e) { return e % 3 == 0; }).sorted(std::greater<int>()).take(2).collect();
+    std::vector<int> checkTop{ 99, 96 };
+    ASSERT_EQ(checkTop, top);
+
+    vector.clear();
+    ASSERT_EQ(0u, getStream().sorted().count());
+}
+
+TEST_F(GeneralTests, SortedLarge) {
+    std::vector<long long> large(400000);
+    streams::detail::SplitMix64 random(5);
+    for (auto& e : large) {
+        e = static_cast<long long>(random.next());
+    }
+    std::vector<long long> check = large;
+    std::sort(check.begin(), check.end());
+
+    for (size_t threads : { 1, 4 }) {
+        auto stream = streams::from(large).sorted(std::less<>(), threads);
+        ASSERT_EQ(large.size(), stream.extractor.remaining());
+        ASSERT_EQ(large.size(), stream.extractor.shared->elements.capacity()); // the size hint
+        ASSERT_EQ(check, stream.collect());
+
+        ASSERT_EQ(check, streams::from(large).sorted([](long long lhs, long long rhs) { return lhs < rhs; }, threads).collect());
+
+        std::vector<Event> events;
+        for (size_t i = 0; i < 100000; ++i) {
+            events.push_back({ static_cast<long>(random.nextBelow(1000)), static_cast<int>(i) });
+        }
+        auto byTime = streams::from(events).sortedBy([](auto& e) { return e.ts; }, threads).collect();
+        std::vector<Event> checkEvents = events;
+        std::stable_sort(checkEvents.begin(), checkEvents.end(), [](auto& lhs, auto& rhs) { return lhs.ts < rhs.ts; });
+        ASSERT_TRUE(std::equal(byTime.begin(), byTime.end(), checkEvents.begin(), [](auto& lhs, auto& rhs) { return lhs.ts == rhs.ts && lhs.value == rhs.value; }));
+    }
+
+    const auto failing = [](long long lhs, long long rhs) { if (lhs == 0 || rhs == 0) throw std::runtime_error("cmp"); return lhs < rhs; };
+    large[300000] = 0;
+    ASSERT_THROW(streams::from(large).sorted(failing, 4).next(), std::runtime_error);
+    ASSERT_THROW(streams::from(large).sortedBy([](long long e) { if (e == 0) throw std::runtime_error("key"); return std::to_string(e); }, 4).next(), std::runtime_error);
+}
+
+
+
+TEST_F(GeneralTests, Iterators) {
+    int sum = 0;
+    for (int e : getStream().filter([](auto& e) { return e % 2 == 0; })) {
+        sum += e;
+    }
+    ASSERT_EQ(2450, sum);
+
+    auto words = getStream().take(3).map([](auto& e) { return std::to_string(e); });
+    std::vector<std::string> strings(words.begin(), words.end());
+    std::vector<std::string> check{ "0", "1", "2" };
+    ASSERT_EQ(check, strings);
+    ASSERT_FALSE(words.next());
+
+    auto stream = getStream();
+    auto it = stream.begin();
+    ASSERT_EQ(0, *it);
+    ++it;
+    ASSERT_EQ(1, *it);
+    ASSERT_EQ(2, *stream.next()); // iterating pulls the stream itself
+    it = stream.begin();
+    ASSERT_EQ(3, *it++);
+    ASSERT_EQ(4, *it);
+    ASSERT_EQ(4950 - 10, std::accumulate(stream.begin(), stream.end(), 0)); // 0 to 4 were pulled
+    ASSERT_TRUE(stream.begin() == stream.end());
+
+    auto texts = getStream().map([](auto& e) { return std::to_string(e); });
+    auto word = texts.begin();
+    std::string first = *word++;
+    ASSERT_EQ("0", first);
+    ASSERT_EQ("1", *word);
+}
+
+TEST_F(GeneralTests, RandomAccessIterators) {
+    auto range = getStream().skip(10).map([](auto& e) { return e * 2; }).randomAccess();
+    ASSERT_EQ(90u, range.size());
+    ASSERT_EQ(90, range.end() - range.begin());
+    ASSERT_EQ(20, *range.begin());
+    ASSERT_EQ(198, range.begin()[89]);
+    ASSERT_EQ(198, *std::prev(range.end()));
+    ASSERT_TRUE(std::binary_search(range.begin(), range.end(), 100));
+    ASSERT_EQ(range.begin() + 40, std::lower_bound(range.begin(), range.end(), 100));
+
+    std::vector<int> reversed(std::make_reverse_iterator(range.end()), std::make_reverse_iterator(range.begin()));
+    ASSERT_EQ(90u, reversed.size());
+    ASSERT_EQ(198, reversed.front());
+
+    auto zipped = streams::zip(getStream(), getStream().skip(1)).randomAccess();
+    ASSERT_EQ(99u, zipped.size());
+    ASSERT_EQ(std::make_tuple(5, 6), zipped.begin()[5]);
+
+#if __cplusplus >= 201703L
+    auto sumOfSquares = std::transform_reduce(range.begin(), range.end(), 0LL, std::plus<>(), [](int e) { return 1LL * e * e; });
+    ASSERT_EQ(streams::from(vector).skip(10).fold(0LL, [](long long a, int e) { return a + 4LL * e * e; }), sumOfSquares);
+#endif
+}
+
+namespace {
+    struct CopyCounted {
+        static size_t copies;
+
+        int value = 0;
+
+        CopyCounted(int value = 0) : value(value) {}
+        CopyCounted(const CopyCounted& other) : value(other.value) { ++copies; }
+        CopyCounted(CopyCounted&&) = default;
+        CopyCounted& operator = (const CopyCounted& other) { value = other.value; ++copies; return *this; }
+        CopyCounted& operator = (CopyCounted&&) = default;
+    };
+
+    size_t CopyCounted::copies = 0;
+}
+
+TEST_F(GeneralTests, RandomAccessOverOwnedData) {
+    std::vector<CopyCounted> items;
+    for (int i = 0; i < 2000; ++i) {
+        items.emplace_back((i * 7919) % 2000);
+    }
+    auto range = streams::from(items).sortedBy([](auto& e) { return e.value; }).randomAccess();
+    ASSERT_EQ(2000u, range.size());
+
+    CopyCounted::copies = 0;
+    int sum = 0;
+    for (auto it = range.begin(); it != range.end(); ++it) {
+        sum += (*it).value;
+    }
+    ASSERT_EQ(1999 * 1000, sum);
+    ASSERT_EQ(2000u, CopyCounted::copies); // one per element returned, the buffer is never copied
+    auto found = std::lower_bound(range.begin(), range.end(), 1234, [](const CopyCounted& e, int v) { return e.value < v; });
+    ASSERT_EQ(1234, (*found).value);
+
+    auto sorted = streams::from(items).sortedBy([](auto& e) { return e.value; });
+    ASSERT_EQ(2000u, sorted.extractor.remaining());
+    auto copy = sorted.extractor;
+    ASSERT_EQ(sorted.extractor.shared->elements.data(), copy.shared->elements.data());
+    copy.jump(5);
+    copy.advance();
+    ASSERT_EQ(5, copy.get()->value);
+    ASSERT_EQ(0, sorted.next()->value); // copies keep their own position
+}
+
+#if defined __cpp_lib_ranges
+TEST_F(GeneralTests, RangesView) {
+    static_assert(std::ranges::view<decltype(getStream().view())>);
+    static_assert(std::ranges::input_range<decltype(getStream())>);
+    static_assert(std::ranges::random_access_range<decltype(getStream().randomAccess())>);
+    static_assert(std::ranges::sized_range<decltype(getStream().randomAccess())>);
+
+    auto view = getStream().filter([](auto& e) { return e % 10 == 0; }).view()
+              | std::views::transform([](int e) { return e / 10; })
+              | std::views::take(4);
+    std::vector<int> check{ 0, 1, 2, 3 };
+    ASSERT_TRUE(std::ranges::equal(check, view));
+
+    auto range = getStream().map([](auto& e) { return 99 - e; }).randomAccess();
+    ASSERT_EQ(99, std::ranges::max(range));
+    ASSERT_EQ(range.begin() + 49, std::ranges::find(range, 50));
+}
+#endif
+
+
+
+#if defined STREAMS_COROUTINES
+namespace {
+    struct Node {
+        int value;
+        std::vector<Node> children;
+    };
+
+    streams::generator<const Node&> preorder(const Node& node) {
+        co_yield node;
+        for (auto& child : node.children) {
+            for (auto& descendant : streams::from(preorder(child))) {
+                co_yield descendant;
+            }
+        }
+    }
+
+    streams::generator<long long> fibonacci() {
+        long long a = 0, b = 1;
+        while (true) {
+            co_yield a;
+            a = std::exchange(b, a + b);
+        }
+    }
+
+    struct CountingArena {
+        size_t allocations = 0;
+        size_t live = 0;
+
+        void* allocate(size_t bytes) { ++allocations; ++live; return ::operator new(bytes); }
+        void deallocate(void* p, size_t) { --live; ::operator delete(p); }
+    };
+
+    streams::generator<int> countdown(std::allocator_arg_t, CountingArena&, int from) {
+        for (int i = from; i > 0; --i) {
+            co_yield i;
+        }
+    }
+}
+
+TEST_F(GeneralTests, CoroutineGenerator) {
+    Node root{ 1, { { 2, { { 3, {} }, { 4, {} } } }, { 5, { { 6, {} } } } } };
+    std::vector<int> check{ 1, 2, 3, 4, 5, 6 };
+    ASSERT_EQ(check, streams::from(preorder(root)).map([](const Node& n) { return n.value; }).collect());
+
+    auto nodes = streams::from(preorder(root));
+    ASSERT_EQ(&root, &*nodes.begin()); // references, not copies
+    ASSERT_EQ(&root.children[1].children[0], &*streams::from(preorder(root)).filter([](auto& n) { return n.value == 6; }).begin());
+
+    std::vector<long long> checkFibonacci{ 0, 1, 1, 2, 3, 5, 8, 13, 21, 34 };
+    ASSERT_EQ(checkFibonacci, streams::from(fibonacci()).take(10).collect());
+    ASSERT_EQ(832040, *streams::from(fibonacci()).skip(30).next());
+
+    CountingArena arena;
+    auto finished = streams::from(countdown(std::allocator_arg, arena, 0));
+    ASSERT_FALSE(finished.next());
+    ASSERT_FALSE(finished.next());
+}
+
+namespace {
+    streams::generator<int> failing() {
+        co_yield 1;
+        co_yield 2;
+        throw std::runtime_error("broken source");
+    }
+}
+
+TEST_F(GeneralTests, CoroutineExceptions) {
+    auto stream = streams::from(failing());
+    ASSERT_EQ(1, *stream.next());
+    ASSERT_EQ(2, *stream.next());
+    ASSERT_THROW(stream.next(), std::runtime_error);
+    ASSERT_FALSE(stream.next()); // the coroutine has finished
+
+    ASSERT_THROW(streams::from(failing()).map([](int e) { return e * 2; }).collect(), std::runtime_error);
+}
+
+TEST_F(GeneralTests, CoroutineFramesAcrossThreads) {
+    std::vector<streams::generator<long long>> made;
+    std::thread([&made] {
+        for (int i = 0; i < 8; ++i) {
+            made.push_back(fibonacci());
+            made.back().next();
+        }
+    }).join(); // the creating thread and its pool are gone
+
+    std::thread([&made] { made.clear(); }).join();
+
+    for (int round = 0; round < 50; ++round) {
+        std::vector<streams::generator<long long>> batch;
+        for (int i = 0; i < 4; ++i) {
+            batch.push_back(fibonacci());
+        }
+        std::thread destroyer([batch = std::move(batch)]() mutable { batch.clear(); });
+        auto local = streams::from(fibonacci()).take(5).collect(); // the main pool, meanwhile
+        ASSERT_EQ(5u, local.size());
+        destroyer.join();
+    }
+}
+
+TEST_F(GeneralTests, CoroutineFrameAllocation) {
+    CountingArena arena;
+    {
+        auto stream = streams::from(countdown(std::allocator_arg, arena, 3));
+        ASSERT_EQ(1u, arena.live);
+        std::vector<int> check{ 3, 2, 1 };
+        ASSERT_EQ(check, std::move(stream).collect());
+    }
+    ASSERT_EQ(1u, arena.allocations);
+    ASSERT_EQ(0u, arena.live);
+
+    void* frame = fibonacci().handle.address();
+    for (int i = 0; i < 3; ++i) {
+        ASSERT_EQ(frame, fibonacci().handle.address()); // recycled by the thread's pool
+    }
+}
+#endif
+
+
+
+TEST_F(GeneralTests, BudgetedElements) {
+    auto stream = getStream();
+    streams::Budget budget;
+    budget.elements = 30;
+
+    int sum = 0;
+    size_t calls = 0;
+    for (bool finished = false; !finished; ++calls) {
+        auto partial = stream.foldFor(budget, sum, [](int a, int e) { return a + e; });
+        ASSERT_LE(partial.processed, 30u);
+        sum = partial.value;
+        finished = partial.finished;
+    }
+    ASSERT_EQ(4950, sum);
+    ASSERT_EQ(4u, calls); // 30 + 30 + 30 + 10
+    ASSERT_FALSE(stream.next());
+
+    std::vector<int> seen;
+    auto counter = streams::generate::counter(0);
+    auto progress = counter.forEachFor(budget, [&seen](size_t e) { seen.push_back(static_cast<int>(e)); });
+    ASSERT_EQ(30u, progress.processed);
+    ASSERT_FALSE(progress.finished);
+    ASSERT_EQ(30u, *counter.next()); // nothing pulled past the budget
+    counter.forEachFor(budget, [&seen](size_t e) { seen.push_back(static_cast<int>(e)); });
+    ASSERT_EQ(60u, seen.size());
+    ASSERT_EQ(31, seen[30]);
+
+    vector.clear();
+    auto empty = getStream().forEachFor(budget, [](int) {});
+    ASSERT_EQ(0u, empty.processed);
+    ASSERT_TRUE(empty.finished);
+}
+
+TEST_F(GeneralTests, BudgetedTime) {
+    using namespace std::chrono;
+    streams::Budget budget;
+    budget.time = milliseconds(20);
+    budget.batch = 16;
+
+    auto slow = streams::generate::counter(0).map([](size_t e) {
+        std::this_thread::sleep_for(milliseconds(1));
+        return e;
+    });
+    auto first = slow.foldFor(budget, size_t(0), [](size_t a, size_t) { return a + 1; });
+    ASSERT_FALSE(first.finished);
+    ASSERT_GE(first.processed, 16u); // the first batch always runs
+    ASSERT_EQ(0u, first.processed % 16); // the clock is only read between batches
+    ASSERT_EQ(first.processed, *slow.next());
+
+    budget.time = nanoseconds(0);
+    auto second = slow.forEachFor(budget, [](size_t) {});
+    ASSERT_EQ(16u, second.processed);
+
+    auto whole = getStream().foldFor(streams::Budget{ seconds(10) }, 0, [](int a, int e) { return a + e; });
+    ASSERT_TRUE(whole.finished);
+    ASSERT_EQ(100u, whole.processed);
+    ASSERT_EQ(4950, whole.value);
+}
+
+
+
 namespace streams {
     template<typename T>
     std::ostream& operator << (std::ostream& os, const Enumerated<T>& e) {